@@ -0,0 +1,964 @@
+/*
+ * Title:  aggregator
+ * Description:  Linux service for the box on a board's terminal face.  It
+ * reads the grid's packets off a serial device (or a pty) and keeps the
+ * global view of it: every board heard from, and for every job its weight,
+ * goal, the rounds each board has reported and an estimate of PI over every
+ * result that crossed the link, brought up to date with each new result.
+ * Jobs stay in the view after the boards have dropped them, so the history
+ * lives here rather than on the boards.
+ *
+ * The attached board only sends results on a face it hasn't taken for its
+ * terminal, so the aggregator never sends it a (t)able or (m)onitor request;
+ * table and telemetry text that does arrive is passed over.  Local clients
+ * connect to a Unix socket and send one command line:
+ *   s          - the view as text tables
+ *   j          - the view as one JSON object
+ *   dA.B[,W]   - request a calculation from the attached board, as though
+ *                typed on its terminal
+ *   x          - reboot the grid
+ * and get their answer before the socket is closed.
+ *
+ * With -c the aggregator is a board too: it runs the sketch on the link,
+ * under its own ID, and samples with the vectorized kernels in sample.h, so
+ * it contributes results to every job the grid runs (its results enter the
+ * view like anyone else's).  The grid waits on every board it sequenced for
+ * a job, so a contributor has to stay on the link until its jobs finish.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -Ihost host/aggregator.cpp -o aggregator
+ * Usage:
+ *   ./aggregator [-c] [-i ID] [-b BAUD] [-S SOCKET] [-v] DEVICE
+ */
+
+#define SYNERGY_STATE __attribute__((section("synergy_state")))
+#define SFB_STATE SYNERGY_STATE
+
+#include "sketch.h"
+#include "../synergy.cpp"
+#include "sample.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <set>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+extern char __start_synergy_state[]; // provided by the linker
+extern char __stop_synergy_state[];
+
+const u32 AGG_NONE = 0xffffffff; // no time yet
+const u32 AGG_TX_LIMIT = 1 << 16; // bytes held for a link that doesn't drain
+const u32 AGG_CLIENT_LIMIT = 256; // bytes a client's command may run to
+const u32 AGG_IDLE = 3 * pingAll_PERIOD; // silence after which a board is shown idle
+
+/*
+ * Summary:     A board, as the aggregator knows it
+ * Contains:    When it was first and last heard from, newest packet key,
+ *              records and distinct results it originated
+ */
+struct AGG_NODE
+{
+  u32 first; // time it was first heard from
+  u32 last; // time it was last heard from
+  u32 stamp; // newest packet key it originated
+  u32 records; // result records of its that crossed the link
+  u32 results; // distinct round results among them
+};
+
+/*
+ * Summary:     A board's part in a job
+ * Contains:    Rounds it has reported a result for, the newest of them
+ */
+struct AGG_SHARE
+{
+  std::set<u32> rounds; // rounds it has reported a result for
+  u32 newest; // newest of them
+};
+
+/*
+ * Summary:     A job, as the aggregator knows it
+ * Contains:    Request, when it was first heard of and reached its goal,
+ *              points sampled and inside the circle, the estimate, the
+ *              boards taking part
+ */
+struct AGG_JOB
+{
+  u32 weight; // share of the sampling
+  u32 doa1; // goal (whole portion)
+  u32 doa2; // goal (decimal portion)
+  u32 first; // time it was first heard of
+  u32 reached; // time the estimate reached the goal, AGG_NONE until then
+  u64 inside; // points inside the circle, over every result
+  u64 points; // points sampled, over every result
+  double pi; // estimate of PI
+  double accuracy; // accuracy of the estimate in percent
+  std::map<u32, AGG_SHARE> shares; // by board ID
+};
+
+/*
+ * Summary:     A local client waiting on its answer
+ * Contains:    Socket, command read so far
+ */
+struct AGG_CLIENT
+{
+  int fd; // connection
+  std::string line; // command read so far
+};
+
+/* configuration */
+const char * AGG_DEVICE = 0; // serial device or pty the board is on
+const char * AGG_SOCKET = "synergy.sock"; // where local clients connect
+u32 AGG_BAUD = 115200; // line speed of a serial device
+u32 AGG_ID = 0; // ID the aggregator goes by with -c, 0 if it only listens
+
+/* the view */
+std::map<u32, AGG_NODE> AGG_NODES; // by board ID
+std::map<u32, AGG_JOB> AGG_JOBS; // by job ID
+u32 AGG_RECORDS = 0; // result records that crossed the link
+u32 AGG_OTHER = 0; // lines that weren't results (pings, table text, ...)
+u32 AGG_REBOOTS = 0; // reboots of the grid seen
+u32 AGG_REBOOT_AT = AGG_NONE; // time of the last of them
+
+/* the link and the socket */
+int AGG_LINK = -1; // device
+int AGG_LISTEN = -1; // socket clients connect to
+std::string AGG_RX; // bytes of the line being received
+std::string AGG_TX; // bytes waiting for the link
+u32 AGG_TX_DROPPED = 0; // packets the link had no room for
+std::vector<AGG_CLIENT> AGG_CLIENTS;
+std::string AGG_OUT[4]; // bytes of the packet the sketch is printing on each face
+u64 AGG_START; // monotonic time the service started at, in nanoseconds
+volatile sig_atomic_t AGG_STOP = 0; // set by SIGINT or SIGTERM
+std::vector<char> PRISTINE; // the section as the program started
+
+/*
+ * Summary:     Reads the monotonic clock.
+ * Parameters:  None.
+ * Return:      u64 time in nanoseconds.
+ */
+u64
+aggNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (u64) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Summary:     Parses a base-36 board ID.
+ * Parameters:  Text.
+ * Return:      u32 ID, or 0 if the text isn't one.
+ */
+u32
+aggBase36(const char * TEXT)
+{
+  u32 VALUE = 0;
+
+  for (const char * p = TEXT; *p; ++p)
+    {
+      char c = *p;
+
+      if ((c >= '0') && (c <= '9'))
+        VALUE = VALUE * 36 + (c - '0');
+      else if ((c >= 'A') && (c <= 'Z'))
+        VALUE = VALUE * 36 + (c - 'A' + 10);
+      else if ((c >= 'a') && (c <= 'z'))
+        VALUE = VALUE * 36 + (c - 'a' + 10);
+      else
+        return 0;
+    }
+
+  return VALUE;
+}
+
+/*
+ * Summary:     Adds a result record to the view.  A round's result counts once
+ *              per board, however many copies of it arrive.
+ * Parameters:  (r)esult record.
+ * Return:      None.
+ */
+void
+aggRecord(struct R_PKT *PKT)
+{
+  u32 NOW = millis();
+
+  ++AGG_RECORDS;
+
+  AGG_NODE *N = &AGG_NODES[PKT->key.ID];
+
+  if (0 == N->records++)
+    N->first = NOW;
+
+  N->last = NOW;
+
+  if ((s32) (PKT->key.TIME - N->stamp) > 0)
+    N->stamp = PKT->key.TIME;
+
+  if (NO_JOB == PKT->job)
+    return; // Only announces the board
+
+  std::map<u32, AGG_JOB>::iterator IT = AGG_JOBS.find(PKT->job);
+
+  if (AGG_JOBS.end() == IT)
+    {
+      AGG_JOB FRESH;
+
+      FRESH.weight = PKT->weight;
+      FRESH.doa1 = PKT->doa1;
+      FRESH.doa2 = PKT->doa2;
+      FRESH.first = NOW;
+      FRESH.reached = AGG_NONE;
+      FRESH.inside = FRESH.points = 0;
+      FRESH.pi = FRESH.accuracy = 0;
+      IT = AGG_JOBS.insert(std::make_pair(PKT->job, FRESH)).first;
+    }
+
+  AGG_JOB *J = &IT->second;
+  AGG_SHARE *S = &J->shares[PKT->key.ID];
+
+  if ((0 == PKT->result) || !S->rounds.insert(PKT->round).second)
+    return; // Only announces the job, or a copy of a result already counted
+
+  if (PKT->round > S->newest)
+    S->newest = PKT->round;
+
+  ++N->results;
+  J->inside += PKT->result;
+  J->points += MAX_POINTS_GEN;
+  J->pi = 4.0 * J->inside / J->points;
+  J->accuracy = 100.0 - fabs(J->pi - PI) * PI_PERCENT;
+
+  if ((AGG_NONE == J->reached) && (J->accuracy >= doaConvert(J->doa1, J->doa2)))
+    J->reached = NOW;
+
+  return;
+}
+
+/*
+ * Summary:     Adds a line that crossed the link, either way, to the view.
+ *              (r)esult and (b)atch packets are read with the sketch's own
+ *              scanner; anything else is only counted.
+ * Parameters:  Packet.
+ * Return:      None.
+ */
+void
+aggLedger(sfbhost::Packet * PKT)
+{
+  u8 *packet = (u8 *) PKT;
+  R_PKT PKT_R;
+
+  PKT->cursor = 0;
+
+  if ('r' == PKT->data[0])
+    {
+      if (packetScanf(packet, "%Zr%z\n", R_ZScanner, &PKT_R) == 3)
+        aggRecord(&PKT_R);
+    }
+
+  else if ('b' == PKT->data[0])
+    {
+      if (packetScanf(packet, "%Zb%z", R_ZScanner, &PKT_R) == 2)
+        {
+          aggRecord(&PKT_R);
+
+          while (packetScanf(packet, "%Z;%z", R_ZScanner, &PKT_R) == 2)
+            aggRecord(&PKT_R);
+        }
+    }
+
+  else if (('x' == PKT->data[0]) && (2 == PKT->len))
+    {
+      if ((AGG_NONE == AGG_REBOOT_AT) || (millis() - AGG_REBOOT_AT
+          > REBOOT_DELAY))
+        ++AGG_REBOOTS; // The signal echoes around the grid for a while
+
+      AGG_REBOOT_AT = millis();
+    }
+
+  else
+    ++AGG_OTHER;
+
+  PKT->cursor = 0;
+
+  return;
+}
+
+/*
+ * Summary:     Queues a packet for the link, whole or not at all.
+ * Parameters:  Bytes, u32 length.
+ * Return:      None.
+ */
+void
+aggSend(const char * DATA, u32 LEN)
+{
+  if (AGG_TX.size() + LEN > AGG_TX_LIMIT)
+    {
+      ++AGG_TX_DROPPED;
+      return;
+    }
+
+  AGG_TX.append(DATA, LEN);
+
+  return;
+}
+
+/*
+ * Summary:     Collects the sketch's output into packets.  Those on face 0,
+ *              the link, are queued for it and added to the view; the other
+ *              faces have nothing attached.
+ * Parameters:  u8 face, bytes, u32 length.
+ * Return:      None.
+ */
+void
+aggSink(u8 face, const char * data, u32 len)
+{
+  for (u32 i = 0; i < len; ++i)
+    {
+      AGG_OUT[face] += data[i];
+
+      if ('\n' != data[i])
+        continue;
+
+      if ((0 == face) && (AGG_OUT[face].size() <= sfbhost::MAX_PACKET))
+        {
+          sfbhost::Packet PKT;
+
+          PKT.face = face;
+          PKT.len = AGG_OUT[face].size();
+          memcpy(PKT.data, AGG_OUT[face].data(), PKT.len);
+          aggSend(PKT.data, PKT.len);
+          aggLedger(&PKT);
+        }
+
+      AGG_OUT[face].clear();
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Stands in for reenterBootloader(): the sketch starts over.
+ * Parameters:  None.
+ * Return:      None (unwinds to the main loop).
+ */
+void
+aggReboot()
+{
+  throw AGG_ID;
+}
+
+/*
+ * Summary:     Boots the sketch from the pristine section.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+aggBoot()
+{
+  memcpy(__start_synergy_state, &PRISTINE[0], PRISTINE.size());
+
+  for (u32 f = 0; f < 4; ++f)
+    AGG_OUT[f].clear();
+
+  setup();
+
+  return;
+}
+
+/*
+ * Summary:     Opens the device and, if it is a terminal, puts it in raw mode
+ *              at the line speed.
+ * Parameters:  None.
+ * Return:      bool true if the device is ready.
+ */
+bool
+aggOpenLink()
+{
+  AGG_LINK = open(AGG_DEVICE, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+  if (AGG_LINK < 0)
+    {
+      perror(AGG_DEVICE);
+      return false;
+    }
+
+  if (!isatty(AGG_LINK))
+    return true; // A FIFO or a socket file needs no line settings
+
+  struct termios TIO;
+  speed_t SPEED;
+
+  switch (AGG_BAUD)
+    {
+  case 9600:
+    SPEED = B9600;
+    break;
+  case 19200:
+    SPEED = B19200;
+    break;
+  case 38400:
+    SPEED = B38400;
+    break;
+  case 57600:
+    SPEED = B57600;
+    break;
+  case 115200:
+    SPEED = B115200;
+    break;
+  case 230400:
+    SPEED = B230400;
+    break;
+  default:
+    fprintf(stderr, "aggregator:  Unsupported line speed %u.\n", AGG_BAUD);
+    return false;
+    }
+
+  if (tcgetattr(AGG_LINK, &TIO) < 0)
+    {
+      perror("tcgetattr");
+      return false;
+    }
+
+  cfmakeraw(&TIO);
+  TIO.c_cflag |= CLOCAL | CREAD;
+  cfsetispeed(&TIO, SPEED);
+  cfsetospeed(&TIO, SPEED);
+
+  if (tcsetattr(AGG_LINK, TCSANOW, &TIO) < 0)
+    {
+      perror("tcsetattr");
+      return false;
+    }
+
+  tcflush(AGG_LINK, TCIOFLUSH); // Whatever was waiting predates us
+
+  return true;
+}
+
+/*
+ * Summary:     Opens the socket local clients connect to, replacing a stale
+ *              one left behind.
+ * Parameters:  None.
+ * Return:      bool true if it is listening.
+ */
+bool
+aggOpenSocket()
+{
+  struct sockaddr_un ADDR;
+
+  if (strlen(AGG_SOCKET) >= sizeof(ADDR.sun_path))
+    {
+      fprintf(stderr, "aggregator:  Socket path %s is too long.\n", AGG_SOCKET);
+      return false;
+    }
+
+  memset(&ADDR, 0, sizeof(ADDR));
+  ADDR.sun_family = AF_UNIX;
+  strcpy(ADDR.sun_path, AGG_SOCKET);
+  unlink(AGG_SOCKET);
+
+  AGG_LISTEN = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+  if ((AGG_LISTEN < 0) || (bind(AGG_LISTEN, (struct sockaddr *) &ADDR,
+      sizeof(ADDR)) < 0) || (listen(AGG_LISTEN, 8) < 0))
+    {
+      perror(AGG_SOCKET);
+      return false;
+    }
+
+  return true;
+}
+
+/*
+ * Summary:     Takes the bytes waiting on the link and handles every complete
+ *              line: it is added to the view and, with -c, handed to the
+ *              sketch.  Lines too long for a packet are passed over.
+ * Parameters:  None.
+ * Return:      bool false once the device has gone away.
+ */
+bool
+aggReceive()
+{
+  char BUF[4096];
+  ssize_t GOT;
+
+  while ((GOT = read(AGG_LINK, BUF, sizeof(BUF))) > 0)
+    for (ssize_t i = 0; i < GOT; ++i)
+      {
+        AGG_RX += BUF[i];
+
+        if ('\n' != BUF[i])
+          continue;
+
+        if (AGG_RX.size() <= sfbhost::MAX_PACKET)
+          {
+            sfbhost::Packet PKT;
+
+            PKT.face = 0;
+            PKT.len = AGG_RX.size();
+            memcpy(PKT.data, AGG_RX.data(), PKT.len);
+            aggLedger(&PKT);
+
+            if (AGG_ID)
+              {
+                try
+                  {
+                    sfbhost::dispatch(PKT);
+                  }
+                catch (u32)
+                  { // The sketch rebooted
+                    aggBoot();
+                  }
+              }
+          }
+
+        AGG_RX.clear();
+      }
+
+  if (0 == GOT)
+    return isatty(AGG_LINK); // A terminal reads nothing at times; anything else has closed
+
+  return (EAGAIN == errno) || (EINTR == errno);
+}
+
+/*
+ * Summary:     Writes as much of the queued output as the link takes.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+aggTransmit()
+{
+  while (!AGG_TX.empty())
+    {
+      ssize_t PUT = write(AGG_LINK, AGG_TX.data(), AGG_TX.size());
+
+      if (PUT <= 0)
+        return; // Full for now, or gone; the next read will tell
+
+      AGG_TX.erase(0, PUT);
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Formats text onto the end of a string.
+ * Parameters:  String, printf format and arguments.
+ * Return:      None.
+ */
+void
+aggPrintf(std::string & OUT, const char * FMT, ...)
+{
+  char BUF[256];
+  va_list AP;
+
+  va_start(AP, FMT);
+  vsnprintf(BUF, sizeof(BUF), FMT, AP);
+  va_end(AP);
+  OUT += BUF;
+
+  return;
+}
+
+/*
+ * Summary:     Renders the view as text tables.
+ * Parameters:  String to append to.
+ * Return:      None.
+ */
+void
+aggText(std::string & OUT)
+{
+  u32 NOW = millis();
+
+  aggPrintf(OUT, "LINK %s  UP %u s  RECORDS %u  OTHER %u  DROPPED %u  "
+    "REBOOTS %u\n", AGG_DEVICE, NOW / 1000, AGG_RECORDS, AGG_OTHER,
+      AGG_TX_DROPPED, AGG_REBOOTS);
+
+  if (AGG_ID)
+    aggPrintf(OUT, "CONTRIBUTING AS %s (%s kernel)\n",
+        sfbhost::base36(AGG_ID).c_str(), SAMPLE_NAME);
+
+  aggPrintf(OUT, "\nID        ACTIVE   RECORDS   RESULTS  TIME-STAMP   IDLE MS\n");
+
+  for (std::map<u32, AGG_NODE>::iterator IT = AGG_NODES.begin(); IT
+      != AGG_NODES.end(); ++IT)
+    aggPrintf(OUT, "%-10s%6c%10u%10u%12u%10u\n",
+        sfbhost::base36(IT->first).c_str(), ((NOW - IT->second.last
+            < AGG_IDLE) ? 'Y' : 'N'), IT->second.records,
+        IT->second.results, IT->second.stamp, NOW - IT->second.last);
+
+  aggPrintf(OUT, "\nJOB       WEIGHT     GOAL  BOARDS  ROUND   RESULTS   PI ESTIMATE"
+    "  ACCURACY   REACHED S\n");
+
+  for (std::map<u32, AGG_JOB>::iterator IT = AGG_JOBS.begin(); IT
+      != AGG_JOBS.end(); ++IT)
+    {
+      AGG_JOB *J = &IT->second;
+      u32 NEWEST = 0;
+
+      for (std::map<u32, AGG_SHARE>::iterator S = J->shares.begin(); S
+          != J->shares.end(); ++S)
+        if (S->second.newest > NEWEST)
+          NEWEST = S->second.newest;
+
+      aggPrintf(OUT, "%-10s%6u%9.4f%8u%7u%10llu%14.10f%10.4f", sfbhost::base36(
+          IT->first).c_str(), J->weight, doaConvert(J->doa1, J->doa2),
+          (u32) J->shares.size(), NEWEST, (unsigned long long) (J->points
+              / MAX_POINTS_GEN), J->pi, J->accuracy);
+
+      if (AGG_NONE == J->reached)
+        aggPrintf(OUT, "         -\n");
+      else
+        aggPrintf(OUT, "%10.3f\n", (J->reached - J->first) / 1000.0);
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Renders the view as one JSON object.
+ * Parameters:  String to append to.
+ * Return:      None.
+ */
+void
+aggJson(std::string & OUT)
+{
+  u32 NOW = millis();
+  bool FIRST = true;
+
+  aggPrintf(OUT, "{\"up\":%u,\"records\":%u,\"other\":%u,\"dropped\":%u,"
+    "\"reboots\":%u,\"id\":\"%s\",\"nodes\":[", NOW, AGG_RECORDS, AGG_OTHER,
+      AGG_TX_DROPPED, AGG_REBOOTS, (AGG_ID ? sfbhost::base36(AGG_ID).c_str()
+          : ""));
+
+  for (std::map<u32, AGG_NODE>::iterator IT = AGG_NODES.begin(); IT
+      != AGG_NODES.end(); ++IT, FIRST = false)
+    aggPrintf(OUT, "%s{\"id\":\"%s\",\"records\":%u,\"results\":%u,"
+      "\"stamp\":%u,\"idle\":%u}", (FIRST ? "" : ","), sfbhost::base36(
+        IT->first).c_str(), IT->second.records, IT->second.results,
+        IT->second.stamp, NOW - IT->second.last);
+
+  aggPrintf(OUT, "],\"jobs\":[");
+  FIRST = true;
+
+  for (std::map<u32, AGG_JOB>::iterator IT = AGG_JOBS.begin(); IT
+      != AGG_JOBS.end(); ++IT, FIRST = false)
+    {
+      AGG_JOB *J = &IT->second;
+
+      aggPrintf(OUT, "%s{\"job\":\"%s\",\"weight\":%u,\"goal\":%.4f,"
+        "\"results\":%llu,\"pi\":%.10f,\"acc\":%.4f,\"reached\":", (FIRST ? ""
+          : ","), sfbhost::base36(IT->first).c_str(), J->weight, doaConvert(
+          J->doa1, J->doa2), (unsigned long long) (J->points / MAX_POINTS_GEN),
+          J->pi, J->accuracy);
+
+      if (AGG_NONE == J->reached)
+        aggPrintf(OUT, "null,\"rounds\":{");
+      else
+        aggPrintf(OUT, "%u,\"rounds\":{", J->reached - J->first);
+
+      for (std::map<u32, AGG_SHARE>::iterator S = J->shares.begin(); S
+          != J->shares.end(); ++S)
+        aggPrintf(OUT, "%s\"%s\":%u", ((J->shares.begin() == S) ? "" : ","),
+            sfbhost::base36(S->first).c_str(), S->second.newest);
+
+      aggPrintf(OUT, "}}");
+    }
+
+  aggPrintf(OUT, "]}\n");
+
+  return;
+}
+
+/*
+ * Summary:     Carries out a client's command.  A (d)istribute request is
+ *              checked the way the boards check it before it is sent on.
+ * Parameters:  Command line, without its newline; string for the answer.
+ * Return:      None.
+ */
+void
+aggCommand(const std::string & LINE, std::string & OUT)
+{
+  if ("s" == LINE)
+    aggText(OUT);
+
+  else if ("j" == LINE)
+    aggJson(OUT);
+
+  else if ("x" == LINE)
+    {
+      aggSend("x\n", 2);
+      aggPrintf(OUT, "ok\n");
+    }
+
+  else if (('d' == LINE[0]) && (LINE.size() + 1 < sfbhost::MAX_PACKET))
+    {
+      sfbhost::Packet PKT;
+      D_PKT PKT_D;
+
+      PKT.face = 0;
+      PKT.cursor = 0;
+      PKT.len = snprintf(PKT.data, sizeof(PKT.data), "%s\n", LINE.c_str());
+
+      if (packetScanf((u8 *) &PKT, "%Zd%z\n", D_ZScanner, &PKT_D) != 3)
+        aggPrintf(OUT, "error: expected dA.B or dA.B,W\n");
+      else if (doaConvert(PKT_D.doa1, PKT_D.doa2) > DOA_THRESHOLD)
+        aggPrintf(OUT, "error: accuracy must not exceed %f\n", DOA_THRESHOLD);
+      else if ((0 == PKT_D.weight) || (PKT_D.weight > MAX_WEIGHT))
+        aggPrintf(OUT, "error: weight must be between 1 and %u\n", MAX_WEIGHT);
+      else
+        {
+          aggSend(PKT.data, PKT.len);
+          aggPrintf(OUT, "ok\n");
+        }
+    }
+
+  else
+    aggPrintf(OUT, "error: commands are s, j, dA.B[,W] and x\n");
+
+  return;
+}
+
+/*
+ * Summary:     Reads from a client and answers once its command is complete
+ *              (or it has stopped sending).
+ * Parameters:  Client.
+ * Return:      bool true once the client is done with.
+ */
+bool
+aggServe(AGG_CLIENT * C)
+{
+  char BUF[AGG_CLIENT_LIMIT];
+  ssize_t GOT = read(C->fd, BUF, sizeof(BUF));
+
+  if ((GOT < 0) && ((EAGAIN == errno) || (EINTR == errno)))
+    return false;
+
+  if (GOT > 0)
+    C->line.append(BUF, GOT);
+
+  size_t END = C->line.find('\n');
+
+  if ((std::string::npos == END) && (GOT > 0) && (C->line.size()
+      < AGG_CLIENT_LIMIT))
+    return false; // More to come
+
+  std::string OUT;
+
+  C->line.resize((std::string::npos == END) ? C->line.size() : END);
+
+  if (!C->line.empty() && ('\r' == C->line[C->line.size() - 1]))
+    C->line.resize(C->line.size() - 1);
+
+  aggCommand(C->line.empty() ? "s" : C->line, OUT);
+
+  for (size_t SENT = 0; SENT < OUT.size();)
+    {
+      ssize_t PUT = send(C->fd, OUT.data() + SENT, OUT.size() - SENT,
+          MSG_NOSIGNAL);
+
+      if (PUT <= 0)
+        break;
+
+      SENT += PUT;
+    }
+
+  close(C->fd);
+
+  return true;
+}
+
+/*
+ * Summary:     Tells how long the main loop may wait for the link or a
+ *              client before the sketch needs to run.
+ * Parameters:  None.
+ * Return:      int milliseconds, -1 for as long as it takes.
+ */
+int
+aggTimeout()
+{
+  if (!AGG_ID)
+    return (AGG_TX.empty() ? -1 : 10);
+
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if ((NO_JOB != JOB_ARR[i].id) && JOB_ARR[i].tx_flag)
+      return 0; // Points to sample
+
+  for (u32 i = 0; i < 4; ++i)
+    if (TX_QUEUE_ARR[i].count > 0)
+      return 1; // Back once the tokens or the batch deadline allow
+
+  u32 WHEN = 0;
+
+  if (!sfbhost::nextAlarm(WHEN))
+    return -1;
+
+  s32 WAIT = WHEN - millis();
+
+  return ((WAIT > 0) ? WAIT : 0);
+}
+
+/*
+ * Summary:     Stops the main loop.
+ * Parameters:  Signal.
+ * Return:      None.
+ */
+void
+aggStop(int)
+{
+  AGG_STOP = 1;
+
+  return;
+}
+
+int
+main(int argc, char ** argv)
+{
+  int OPT;
+  bool CONTRIBUTE = false;
+
+  while ((OPT = getopt(argc, argv, "ci:b:S:v")) != -1)
+    switch (OPT)
+      {
+    case 'c':
+      CONTRIBUTE = true;
+      break;
+    case 'i':
+      AGG_ID = aggBase36(optarg);
+      break;
+    case 'b':
+      AGG_BAUD = atoi(optarg);
+      break;
+    case 'S':
+      AGG_SOCKET = optarg;
+      break;
+    case 'v':
+      sfbhost::verbose = true;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-c] [-i ID] [-b BAUD] [-S SOCKET] [-v] "
+        "DEVICE\n", argv[0]);
+      return 1;
+      }
+
+  if (optind + 1 != argc)
+    {
+      fprintf(stderr, "usage: %s [-c] [-i ID] [-b BAUD] [-S SOCKET] [-v] "
+        "DEVICE\n", argv[0]);
+      return 1;
+    }
+
+  AGG_DEVICE = argv[optind];
+
+  if (!CONTRIBUTE)
+    AGG_ID = 0;
+  else if (0 == AGG_ID)
+    AGG_ID = aggBase36("HOST");
+
+  if (!aggOpenLink() || !aggOpenSocket())
+    return 1;
+
+  signal(SIGINT, aggStop);
+  signal(SIGTERM, aggStop);
+  signal(SIGPIPE, SIG_IGN);
+
+  AGG_START = aggNow();
+
+  if (AGG_ID)
+    {
+      fprintf(stderr, "aggregator:  Contributing as %s with the %s kernel.\n",
+          sfbhost::base36(AGG_ID).c_str(), sampleSelect());
+      sfbhost::sink = aggSink;
+      sfbhost::bootId = AGG_ID;
+      sfbhost::rebootHook = aggReboot;
+      PRISTINE.assign(__start_synergy_state, __stop_synergy_state);
+      aggBoot();
+    }
+
+  bool UP = true;
+
+  while (UP && !AGG_STOP)
+    {
+      std::vector<struct pollfd> FDS;
+      struct pollfd P;
+
+      P.fd = AGG_LINK;
+      P.events = POLLIN | (AGG_TX.empty() ? 0 : POLLOUT);
+      FDS.push_back(P);
+      P.fd = AGG_LISTEN;
+      P.events = POLLIN;
+      FDS.push_back(P);
+
+      for (u32 i = 0; i < AGG_CLIENTS.size(); ++i)
+        {
+          P.fd = AGG_CLIENTS[i].fd;
+          FDS.push_back(P);
+        }
+
+      if ((poll(&FDS[0], FDS.size(), aggTimeout()) < 0) && (EINTR != errno))
+        {
+          perror("poll");
+          break;
+        }
+
+      sfbhost::now_us = (aggNow() - AGG_START) / 1000;
+
+      if (FDS[0].revents & (POLLIN | POLLHUP | POLLERR))
+        UP = aggReceive();
+
+      for (u32 i = AGG_CLIENTS.size(); i-- > 0;)
+        if (FDS[2 + i].revents && aggServe(&AGG_CLIENTS[i]))
+          AGG_CLIENTS.erase(AGG_CLIENTS.begin() + i);
+
+      if (FDS[1].revents & POLLIN)
+        {
+          int FD;
+
+          while ((FD = accept(AGG_LISTEN, 0, 0)) >= 0)
+            {
+              AGG_CLIENT C;
+
+              C.fd = FD;
+              AGG_CLIENTS.push_back(C);
+            }
+        }
+
+      if (AGG_ID)
+        {
+          try
+            {
+              sfbhost::runAlarms();
+              loop();
+            }
+          catch (u32)
+            { // The sketch rebooted
+              aggBoot();
+            }
+        }
+
+      aggTransmit();
+    }
+
+  if (!UP)
+    fprintf(stderr, "aggregator:  %s closed.\n", AGG_DEVICE);
+
+  for (u32 i = 0; i < AGG_CLIENTS.size(); ++i)
+    close(AGG_CLIENTS[i].fd);
+
+  close(AGG_LISTEN);
+  unlink(AGG_SOCKET);
+  close(AGG_LINK);
+
+  return 0;
+}
@@ -0,0 +1,603 @@
+/*
+ * Title:  bench
+ * Description:  Microbenchmarks of the sketch's hot functions on Linux: the
+ * sampling in calculate(), the (r)esult and (d)istribute packet printer and
+ * scanners, log() against how full the node table is, sequenceOrder()
+ * against the node count, compileResults() per round and a full table
+ * refresh.  Every benchmark starts from a freshly booted board
+ * (the sketch's state is gathered into the "synergy_state" section and put
+ * back between benchmarks) and is timed over several runs of at least
+ * BENCH_RUN_NS each; the median and best runs are kept.  A benchmark whose
+ * operations did no work is named on stderr and the exit status is 1.
+ *
+ * Results are CSV, one line per benchmark and parameter, tagged with a label
+ * (a commit, say).  Given the file of an earlier run, the change in the
+ * median of every benchmark the two share is printed as well.  Times come
+ * from the host build: the SFB stand-in's printf and scanf are not the IXM's,
+ * so compare runs with each other rather than with the boards.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -Ihost host/bench.cpp -o bench
+ * Usage:
+ *   ./bench [-o RESULTS.csv] [-l LABEL] [-c BASELINE.csv] [-f FILTER]
+ */
+
+#define SYNERGY_STATE __attribute__((section("synergy_state")))
+#define SFB_STATE SYNERGY_STATE
+
+#include "sketch.h"
+#include "../synergy.cpp"
+#include "sample.h"
+
+#include <algorithm>
+#include <map>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+extern char __start_synergy_state[]; // provided by the linker
+extern char __stop_synergy_state[];
+
+const u64 BENCH_RUN_NS = 20000000; // shortest timed run
+const u32 BENCH_RUNS = 5; // timed runs per benchmark, the median is reported
+const u32 BENCH_ROUND_POINTS = MAX_POINTS_GEN / SAMPLE_BATCH * SAMPLE_BATCH; // points calculate() is held under
+
+/*
+ * Summary:     A benchmark
+ * Contains:    Name, unit of work, preparation and one operation, both given
+ *              the parameter; the operation returns the units it did
+ */
+struct BENCH
+{
+  const char * name; // what is measured
+  const char * unit; // what an operation does, counted for the rate
+  void (*prepare)(u32 PARAM); // run once on a fresh board
+  u32 (*op)(u32 PARAM); // the timed operation
+  u32 params[6]; // parameters it is run with, 0 ending the list early
+};
+
+/*
+ * Summary:     A benchmark's result
+ * Contains:    Operations per run, nanoseconds per operation (median and
+ *              best run), units per second
+ */
+struct BENCH_RESULT
+{
+  u64 ops; // operations per timed run
+  u64 units; // units done in the last timed run
+  double median; // nanoseconds per operation, median run
+  double best; // nanoseconds per operation, best run
+  double rate; // units per second at the median
+};
+
+std::vector<char> PRISTINE; // the section as the program started
+u64 SUNK = 0; // bytes the board printed
+u32 CLOCK = 1; // packet times handed out
+struct JOB SAVED_JOB; // job as compileResults() finds it
+struct sfbhost::Packet PACKET; // packet the scanners read
+struct R_PKT RESULT; // packet the printer writes
+
+/*
+ * Summary:     Counts and drops the board's output.
+ * Parameters:  u8 face, bytes, u32 length.
+ * Return:      None.
+ */
+void
+benchSink(u8, const char *, u32 len)
+{
+  SUNK += len;
+
+  return;
+}
+
+/*
+ * Summary:     Reads the monotonic clock.
+ * Parameters:  None.
+ * Return:      u64 time in nanoseconds.
+ */
+u64
+benchNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (u64) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Summary:     Fills the node table with N nodes, the host first, all active.
+ * Parameters:  u32 nodes.
+ * Return:      None.
+ */
+void
+benchNodes(u32 N)
+{
+  for (u32 i = 1; i < N; ++i)
+    {
+      ID_NODE_ARR[i] = ID_NODE_ARR[0] + 7919 * i; // distinct, not in order
+      NODE_ARR[i].stamp = 1;
+      nodeMark(ACTIVE_NODE_SET, i, true);
+    }
+
+  NODE_COUNT = N;
+  ACTIVE_NODE_COUNT = N;
+
+  return;
+}
+
+/*
+ * Summary:     Starts a job over N nodes whose every node has a result in.
+ * Parameters:  u32 nodes.
+ * Return:      The job.
+ */
+struct JOB *
+benchJob(u32 N)
+{
+  benchNodes(N);
+
+  struct JOB *J = startJob(ID_NODE_ARR[0] << 8, 99, 99, 1);
+
+  for (u32 i = 0; i < N; ++i)
+    {
+      nodeMark(J->held_set[J->round % ROUND_SLOTS], i, true);
+      J->share_arr[i].round = J->round;
+      J->share_arr[i].result = 785;
+    }
+
+  J->sum_arr[J->round % ROUND_SLOTS] = 785 * N;
+
+  J->doa = DOA_THRESHOLD + 1; // never reached, so every round compiles in full
+
+  return J;
+}
+
+/*
+ * Summary:     calculate() for one job, held under its quota so no packets
+ *              go out.  The clock stands still, so the host's allowance for
+ *              rounds is topped up whenever one starts.
+ * Parameters:  Unused.
+ * Return:      Points generated.
+ */
+void
+calculatePrepare(u32)
+{
+  benchJob(1);
+
+  return;
+}
+
+u32
+calculateOp(u32)
+{
+  struct JOB *J = &JOB_ARR[0];
+
+  if (J->points_gen >= BENCH_ROUND_POINTS)
+    J->points_gen = J->result = 0; // Stay under the quota; no packets go out
+
+  if (0 == J->points_gen) // A round starting pays from the allowance
+    bucketFill(&SEND_BUCKET, SEND_BUCKET_DEPTH);
+
+  u32 POINTS = J->points_gen;
+
+  calculate();
+
+  return J->points_gen - POINTS;
+}
+
+/*
+ * Summary:     The sampling kernels alone: the scalar one and the one
+ *              sampleSelect() chose.
+ * Parameters:  u32 points per call.
+ * Return:      Points generated.
+ */
+u32
+scalarOp(u32 N)
+{
+  samplePoints(SAMPLE_LANE_ARR, N);
+
+  return N;
+}
+
+u32
+kernelOp(u32 N)
+{
+  SAMPLE_KERNEL(SAMPLE_LANE_ARR, N);
+
+  return N;
+}
+
+/*
+ * Summary:     Printing a typical (r)esult packet and scanning it, and a
+ *              (d)istribute packet, back.
+ * Parameters:  Unused.
+ * Return:      Bytes printed or scanned.
+ */
+void
+printerPrepare(u32)
+{
+  RESULT.key.ID = 256257; // 5HQ9 in base 36, a typical ID
+  RESULT.key.TIME = 1234567;
+  RESULT.job = 64667905;
+  RESULT.weight = 4;
+  RESULT.round = 118;
+  RESULT.doa1 = 99;
+  RESULT.doa2 = 9900;
+  RESULT.result = 785;
+
+  return;
+}
+
+u32
+printerOp(u32)
+{
+  u64 BEFORE = SUNK;
+
+  facePrintf(0, "%Zr%z\n", R_ZPrinter, &RESULT);
+
+  return SUNK - BEFORE;
+}
+
+void
+rScannerPrepare(u32)
+{
+  PACKET.len = snprintf(PACKET.data, sizeof(PACKET.data),
+      "r5HQ9,1234567,12HQ91,4,118,99.9900,785\n");
+
+  return;
+}
+
+u32
+rScannerOp(u32)
+{
+  struct R_PKT PKT;
+
+  PACKET.cursor = 0;
+
+  return ((3 == packetScanf((u8 *) &PACKET, "%Zr%z\n", R_ZScanner, &PKT))
+      ? PACKET.len : 0); // a packet it can't read counts for nothing
+}
+
+void
+dScannerPrepare(u32)
+{
+  PACKET.len = snprintf(PACKET.data, sizeof(PACKET.data), "d99.9900,4\n");
+
+  return;
+}
+
+u32
+dScannerOp(u32)
+{
+  struct D_PKT PKT;
+
+  PACKET.cursor = 0;
+
+  return ((3 == packetScanf((u8 *) &PACKET, "%Zd%z\n", D_ZScanner, &PKT))
+      ? PACKET.len : 0); // a packet it can't read counts for nothing
+}
+
+/*
+ * Summary:     log() of a packet from the last of N known nodes, the longest
+ *              search.
+ * Parameters:  u32 nodes.
+ * Return:      Packets logged.
+ */
+void
+logPrepare(u32 N)
+{
+  benchNodes(N);
+
+  return;
+}
+
+u32
+logOp(u32 N)
+{
+  log(ID_NODE_ARR[N - 1], ++CLOCK);
+
+  return 1;
+}
+
+/*
+ * Summary:     sequenceOrder() of the last of N active nodes, as a table line
+ *              works it out.
+ * Parameters:  u32 nodes.
+ * Return:      Orders worked out.
+ */
+void
+sequencePrepare(u32 N)
+{
+  benchNodes(N);
+
+  return;
+}
+
+u32
+sequenceOp(u32 N)
+{
+  return (0 != sequenceOrder(ACTIVE_NODE_SET, N - 1));
+}
+
+/*
+ * Summary:     compileResults() of a round with results in from all N nodes.
+ * Parameters:  u32 nodes.
+ * Return:      Rounds compiled.
+ */
+void
+compilePrepare(u32 N)
+{
+  SAVED_JOB = *benchJob(N);
+
+  return;
+}
+
+u32
+compileOp(u32)
+{
+  struct JOB *J = &JOB_ARR[0];
+
+  u32 SLOT = SAVED_JOB.round % ROUND_SLOTS;
+
+  J->round = SAVED_JOB.round; // roundFlush() emptied the slot, so fill it again
+  memcpy(J->held_set[SLOT], SAVED_JOB.held_set[SLOT], sizeof(J->held_set[SLOT]));
+  J->sum_arr[SLOT] = SAVED_JOB.sum_arr[SLOT];
+  compileResults(J);
+
+  return 1;
+}
+
+/*
+ * Summary:     A whole table refresh over N nodes: from a cleared screen, so
+ *              every line is sent, or over an unchanged one, so none is.
+ * Parameters:  u32 nodes.
+ * Return:      Refreshes done.
+ */
+void
+tablePrepare(u32 N)
+{
+  benchJob(N);
+  TERMINAL_FACE = 2;
+  TABLE_CLEAR = true;
+
+  return;
+}
+
+u32
+tableOp(bool CLEAR)
+{
+  TABLE_LINE = 0;
+  TABLE_CLEAR = CLEAR;
+
+  while (tableStep())
+    ;
+
+  return 1;
+}
+
+u32
+tableFullOp(u32)
+{
+  return tableOp(true);
+}
+
+u32
+tableSameOp(u32)
+{
+  return tableOp(false);
+}
+
+BENCH BENCH_ARR[] =
+  {
+    { "calculate", "points", calculatePrepare, calculateOp,
+      { 1 } },
+    { "sample_scalar", "points", 0, scalarOp,
+      { SAMPLE_BATCH, 1024 } },
+    { "sample_kernel", "points", 0, kernelOp,
+      { SAMPLE_BATCH, 1024 } },
+    { "r_zprinter", "bytes", printerPrepare, printerOp,
+      { 1 } },
+    { "r_zscanner", "bytes", rScannerPrepare, rScannerOp,
+      { 1 } },
+    { "d_zscanner", "bytes", dScannerPrepare, dScannerOp,
+      { 1 } },
+    { "log", "packets", logPrepare, logOp,
+      { 1, 4, 8, 16, ARR_LENGTH } },
+    { "sequence_order", "orders", sequencePrepare, sequenceOp,
+      { 2, 4, 8, 16, ARR_LENGTH } },
+    { "compile_results", "rounds", compilePrepare, compileOp,
+      { 1, 4, 8, 16, ARR_LENGTH } },
+    { "table_full", "tables", tablePrepare, tableFullOp,
+      { 1, 8, ARR_LENGTH } },
+    { "table_unchanged", "tables", tablePrepare, tableSameOp,
+      { 1, 8, ARR_LENGTH } } };
+
+/*
+ * Summary:     Boots a fresh board from the pristine section.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+benchBoot()
+{
+  memcpy(__start_synergy_state, &PRISTINE[0], PRISTINE.size());
+  sfbhost::now_us = 1000000;
+  setup();
+
+  return;
+}
+
+/*
+ * Summary:     Times a benchmark with one parameter.
+ * Parameters:  Benchmark, u32 parameter.
+ * Return:      Its result.
+ */
+BENCH_RESULT
+benchRun(const BENCH & B, u32 PARAM)
+{
+  BENCH_RESULT R;
+  u64 UNITS = 0;
+  u64 OPS = 1;
+
+  benchBoot();
+
+  if (B.prepare)
+    B.prepare(PARAM);
+
+  for (;;)
+    { // Find how many operations take BENCH_RUN_NS
+      u64 START = benchNow();
+
+      for (u64 i = 0; i < OPS; ++i)
+        B.op(PARAM);
+
+      if (benchNow() - START >= BENCH_RUN_NS / 4)
+        break;
+
+      OPS *= 2;
+    }
+
+  OPS *= 4;
+
+  std::vector<double> RUNS;
+
+  for (u32 r = 0; r < BENCH_RUNS; ++r)
+    {
+      u64 START = benchNow();
+
+      UNITS = 0;
+
+      for (u64 i = 0; i < OPS; ++i)
+        UNITS += B.op(PARAM);
+
+      RUNS.push_back((double) (benchNow() - START) / OPS);
+    }
+
+  std::sort(RUNS.begin(), RUNS.end());
+  R.units = UNITS;
+  R.ops = OPS;
+  R.median = RUNS[BENCH_RUNS / 2];
+  R.best = RUNS[0];
+  R.rate = (double) UNITS / OPS / R.median * 1e9;
+
+  return R;
+}
+
+/*
+ * Summary:     Reads the medians of an earlier run.
+ * Parameters:  File name, map from "benchmark,parameter" to fill.
+ * Return:      bool true if the file was read.
+ */
+bool
+benchBaseline(const char * NAME, std::map<std::string, double> & MEDIANS)
+{
+  FILE *IN = fopen(NAME, "r");
+  char LINE[256];
+
+  if (!IN)
+    return false;
+
+  while (fgets(LINE, sizeof(LINE), IN))
+    {
+      char LABEL[64];
+      char BENCH[64];
+      char UNIT[64];
+      unsigned PARAM;
+      unsigned long long OPS;
+      double MEDIAN;
+
+      if (6 == sscanf(LINE, "%63[^,],%63[^,],%u,%63[^,],%llu,%lf", LABEL,
+          BENCH, &PARAM, UNIT, &OPS, &MEDIAN))
+        {
+          char KEY[96];
+
+          snprintf(KEY, sizeof(KEY), "%s,%u", BENCH, PARAM);
+          MEDIANS[KEY] = MEDIAN;
+        }
+    }
+
+  fclose(IN);
+
+  return true;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const char * LABEL = "current";
+  const char * FILTER = "";
+  FILE * OUT = stdout;
+  std::map<std::string, double> BASELINE;
+  bool FAILED = false;
+  int OPT;
+
+  while ((OPT = getopt(argc, argv, "o:l:c:f:")) != -1)
+    switch (OPT)
+      {
+    case 'o':
+      if (!(OUT = fopen(optarg, "w")))
+        {
+          perror(optarg);
+          return 1;
+        }
+      break;
+    case 'l':
+      LABEL = optarg;
+      break;
+    case 'c':
+      if (!benchBaseline(optarg, BASELINE))
+        {
+          perror(optarg);
+          return 1;
+        }
+      break;
+    case 'f':
+      FILTER = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-o RESULTS.csv] [-l LABEL] "
+        "[-c BASELINE.csv] [-f FILTER]\n", argv[0]);
+      return 1;
+      }
+
+  PRISTINE.assign(__start_synergy_state, __stop_synergy_state);
+  sfbhost::sink = benchSink;
+  fprintf(stderr, "bench:  sampling kernel %s\n", sampleSelect());
+
+  fprintf(OUT, "label,bench,param,unit,ops,median_ns,best_ns,per_second\n");
+
+  for (u32 b = 0; b < sizeof(BENCH_ARR) / sizeof(BENCH_ARR[0]); ++b)
+    {
+      const BENCH & B = BENCH_ARR[b];
+
+      if (!strstr(B.name, FILTER))
+        continue;
+
+      for (u32 p = 0; (p < 6) && B.params[p]; ++p)
+        {
+          BENCH_RESULT R = benchRun(B, B.params[p]);
+          char KEY[96];
+
+          fprintf(OUT, "%s,%s,%u,%s,%llu,%.2f,%.2f,%.0f\n", LABEL, B.name,
+              B.params[p], B.unit, (unsigned long long) R.ops, R.median,
+              R.best, R.rate);
+          fflush(OUT);
+
+          if (0 == R.units)
+            { // An operation that did nothing was timed, not the work
+              fprintf(stderr, "bench:  %s,%u did no %s.\n", B.name,
+                  B.params[p], B.unit);
+              FAILED = true;
+            }
+
+          snprintf(KEY, sizeof(KEY), "%s,%u", B.name, B.params[p]);
+
+          if (BASELINE.count(KEY))
+            fprintf(stderr, "%-16s%6u %12.2f ns %12.2f ns %+8.1f%%\n", B.name,
+                B.params[p], BASELINE[KEY], R.median, (R.median
+                    / BASELINE[KEY] - 1.0) * 100.0);
+        }
+    }
+
+  return (FAILED ? 1 : 0);
+}
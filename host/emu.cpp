@@ -0,0 +1,674 @@
+/*
+ * Title:  emu
+ * Description:  Wall-clock emulation of a grid of IXM's running the synergy
+ * sketch, spread over every core of a Linux box.  Boards are run by a pool of
+ * worker processes (the sketch's globals are process-wide, so one process can
+ * only hold one board at a time).  Every board's state (everything marked
+ * SYNERGY_STATE or SFB_STATE, gathered into the "synergy_state" section)
+ * lives in shared memory and is copied into the running worker's section for
+ * each activation.  The faces are joined by lock-free single-producer/
+ * single-consumer rings, one per direction of each link: only the one worker
+ * running a board at a time writes its outgoing rings or reads its incoming
+ * ones.
+ *
+ * Each worker claims boards with an atomic compare-and-swap on the board's
+ * owner, first among its own share of the boards and then, when none of those
+ * has work, stealing from the rest.  A board has work when a packet is
+ * waiting for it, an alarm is due or, every millisecond, while it still has
+ * packets queued to send.
+ *
+ * A calculation is requested on board 0 and the run goes until every board
+ * reaches the accuracy (or the time limit).  The time to reach it, the packet
+ * rate, packets dropped on full rings and the activations, steals and busy
+ * time of every worker are printed.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -Ihost host/emu.cpp -o emu
+ * Usage:
+ *   ./emu [-t line|ring|mesh|torus] [-n BOARDS] [-j WORKERS] [-d DOA]
+ *         [-w WAIT_MS] [-T LIMIT_S] [-s SEED]
+ */
+
+#define SYNERGY_STATE __attribute__((section("synergy_state")))
+#define SFB_STATE SYNERGY_STATE
+
+#include "sketch.h"
+#include "../synergy.cpp"
+#include "sample.h"
+#include "topology.h"
+
+#include <atomic>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+extern char __start_synergy_state[]; // provided by the linker
+extern char __stop_synergy_state[];
+
+const u32 EMU_RING_SIZE = 8192; // bytes a ring holds; a power of two
+const u32 EMU_BATCH = 32; // packets a board takes off a ring per activation
+const u32 EMU_NONE = 0xffffffff; // no time yet
+const u32 EMU_FREE = 0; // owner of a board nobody is running
+
+/*
+ * Summary:     One direction of a link, or the terminal's line into a board
+ * Contains:    Read and write positions on separate cache lines, the bytes
+ */
+struct EMU_RING
+{
+  std::atomic<u32> head; // next byte to read, moved by the consumer only
+  char pad_head[60];
+  std::atomic<u32> tail; // next byte to write, moved by the producer only
+  char pad_tail[60];
+  char data[EMU_RING_SIZE];
+};
+
+/*
+ * Summary:     A board, as every worker sees it
+ * Contains:    Owner, when it next has work, partial outgoing packets, totals
+ */
+struct EMU_BOARD
+{
+  std::atomic<u32> owner; // worker running it plus one, EMU_FREE if none
+  std::atomic<u32> wake_at; // time it next needs to run unprompted, EMU_NONE if never
+  bool booted; // whether setup() has run
+  u32 done_at; // time it reached the accuracy, EMU_NONE until then
+  u32 home; // worker whose share it is in
+  u32 runs; // activations
+  u32 received; // packets taken off its rings
+  u32 sent; // packets put on its rings
+  u32 dropped; // packets lost to a full ring
+  u32 out_len[4]; // bytes of the packet being written on each face
+  char out[4][sfbhost::MAX_PACKET];
+  char pad[64];
+};
+
+/*
+ * Summary:     A worker's totals
+ * Contains:    Activations, steals, idle passes, time spent running boards
+ */
+struct EMU_WORKER
+{
+  u64 runs; // activations
+  u64 stolen; // activations of boards from another worker's share
+  u64 idle; // passes that found no work
+  u64 busy; // nanoseconds spent running boards
+  char pad[32];
+};
+
+/*
+ * Summary:     Everything the workers share
+ * Contains:    Start time, stop flag, boards done, boards, workers
+ */
+struct EMU_SHARED
+{
+  u64 start; // monotonic time the run started at, in nanoseconds
+  std::atomic<u32> stop; // set to end the run
+  std::atomic<u32> done; // boards that reached the accuracy
+  u32 requested; // time the calculation was requested
+};
+
+/* configuration */
+const char * EMU_TOPOLOGY = "mesh"; // line, ring, mesh or torus
+u32 EMU_BOARDS = 16; // boards in the grid
+u32 EMU_WORKERS = 0; // worker processes, one per core if 0
+u32 EMU_DOA1 = 99; // requested accuracy (whole portion)
+u32 EMU_DOA2 = 9; // requested accuracy (decimal portion)
+u32 EMU_WAIT = 2000; // milliseconds the grid gets to find itself before the request
+u32 EMU_LIMIT = 120; // seconds before a run gives up
+u32 EMU_SEED = 1; // seed for the boards' random()
+
+/* shared memory, mapped before the workers are forked */
+EMU_SHARED *SHARED;
+EMU_BOARD *BOARDS;
+EMU_WORKER *WORKERS;
+EMU_RING *RINGS; // board * 4 + face going out, then the terminal line of every board
+char *STATES; // every board's copy of the section
+size_t STATE_SIZE;
+
+/* layout, also set before the fork */
+std::vector<s32> LINK_TO; // board * 4 + face: ring written by that face, -1 if unconnected
+std::vector<s32> LINK_FROM; // board * 4 + face: ring read on that face, -1 if none
+std::vector<char> PRISTINE; // the section as the program started
+u32 CURRENT; // board the worker is running
+
+/*
+ * Summary:     Reads the monotonic clock.
+ * Parameters:  None.
+ * Return:      u64 time in nanoseconds.
+ */
+u64
+emuNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (u64) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Summary:     Puts a packet on a ring, whole or not at all.
+ * Parameters:  Ring, bytes, u32 length.
+ * Return:      bool true if it fit.
+ */
+bool
+emuPush(EMU_RING * R, const char * DATA, u32 LEN)
+{
+  u32 TAIL = R->tail.load(std::memory_order_relaxed);
+  u32 HEAD = R->head.load(std::memory_order_acquire);
+
+  if (EMU_RING_SIZE - (TAIL - HEAD) < LEN)
+    return false;
+
+  for (u32 i = 0; i < LEN; ++i)
+    R->data[(TAIL + i) & (EMU_RING_SIZE - 1)] = DATA[i];
+
+  R->tail.store(TAIL + LEN, std::memory_order_release);
+
+  return true;
+}
+
+/*
+ * Summary:     Takes the next packet off a ring.
+ * Parameters:  Ring, packet to fill.
+ * Return:      bool true if there was one.
+ */
+bool
+emuPop(EMU_RING * R, sfbhost::Packet * PKT)
+{
+  u32 HEAD = R->head.load(std::memory_order_relaxed);
+  u32 TAIL = R->tail.load(std::memory_order_acquire);
+
+  if (HEAD == TAIL)
+    return false;
+
+  PKT->len = 0;
+
+  while (HEAD != TAIL)
+    { // Packets are pushed whole, so the newline is always there
+      char c = R->data[HEAD++ & (EMU_RING_SIZE - 1)];
+
+      if (PKT->len < sfbhost::MAX_PACKET)
+        PKT->data[PKT->len++] = c;
+
+      if ('\n' == c)
+        break;
+    }
+
+  R->head.store(HEAD, std::memory_order_release);
+
+  return true;
+}
+
+/*
+ * Summary:     Tells whether a ring holds a packet.
+ * Parameters:  Ring.
+ * Return:      bool true if it does.
+ */
+bool
+emuWaiting(EMU_RING * R)
+{
+  return (R->head.load(std::memory_order_relaxed) != R->tail.load(
+      std::memory_order_relaxed));
+}
+
+/*
+ * Summary:     Collects the running board's output into packets and puts
+ *              each on the ring of its face.
+ * Parameters:  u8 face, bytes, u32 length.
+ * Return:      None.
+ */
+void
+emuSink(u8 face, const char * data, u32 len)
+{
+  EMU_BOARD *B = &BOARDS[CURRENT];
+
+  for (u32 i = 0; i < len; ++i)
+    {
+      if (B->out_len[face] < sfbhost::MAX_PACKET)
+        B->out[face][B->out_len[face]++] = data[i];
+
+      if ('\n' != data[i])
+        continue;
+
+      s32 RING = LINK_TO[CURRENT * 4 + face];
+
+      if (RING >= 0)
+        {
+          if (emuPush(&RINGS[RING], B->out[face], B->out_len[face]))
+            ++B->sent;
+          else
+            ++B->dropped;
+        }
+
+      B->out_len[face] = 0;
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Stands in for reenterBootloader(): the board starts over.
+ * Parameters:  None.
+ * Return:      None (unwinds to the worker).
+ */
+void
+emuReboot()
+{
+  throw CURRENT;
+}
+
+/*
+ * Summary:     Boots the running board from the pristine section.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+emuBoot()
+{
+  memcpy(__start_synergy_state, &PRISTINE[0], STATE_SIZE);
+  sfbhost::bootId = 1000 + CURRENT;
+  sfbhost::rngState = EMU_SEED * 2654435761u + CURRENT + 1;
+  BOARDS[CURRENT].booted = true;
+  setup();
+
+  return;
+}
+
+/*
+ * Summary:     Tells whether a board has work.
+ * Parameters:  u32 board, u32 current time in microseconds.
+ * Return:      bool true if it does.
+ */
+bool
+emuReady(u32 BOARD, u32 NOW)
+{
+  EMU_BOARD *B = &BOARDS[BOARD];
+  u32 WAKE = B->wake_at.load(std::memory_order_relaxed);
+
+  if (!B->booted)
+    return true;
+
+  if ((EMU_NONE != WAKE) && ((s32) (NOW - WAKE) >= 0))
+    return true;
+
+  for (u32 f = 0; f < 4; ++f)
+    if ((LINK_FROM[BOARD * 4 + f] >= 0) && emuWaiting(
+        &RINGS[LINK_FROM[BOARD * 4 + f]]))
+      return true;
+
+  return emuWaiting(&RINGS[EMU_BOARDS * 4 + BOARD]);
+}
+
+/*
+ * Summary:     Runs a board the worker has claimed: its packets, its alarms
+ *              and loop().
+ * Parameters:  u32 board.
+ * Return:      None.
+ */
+void
+emuRun(u32 BOARD)
+{
+  EMU_BOARD *B = &BOARDS[BOARD];
+  char *STATE = STATES + (size_t) BOARD * STATE_SIZE;
+
+  CURRENT = BOARD;
+  sfbhost::now_us = (u32) ((emuNow() - SHARED->start) / 1000);
+  memcpy(__start_synergy_state, STATE, STATE_SIZE);
+  ++B->runs;
+
+  try
+    {
+      if (!B->booted)
+        emuBoot();
+
+      sfbhost::Packet PKT;
+
+      for (u32 f = 0; f <= 4; ++f)
+        { // The four faces, then the terminal line (taken as face 0)
+          s32 RING = ((f < 4) ? LINK_FROM[BOARD * 4 + f] : (s32) (EMU_BOARDS
+              * 4 + BOARD));
+
+          for (u32 n = 0; (RING >= 0) && (n < EMU_BATCH) && emuPop(
+              &RINGS[RING], &PKT); ++n)
+            {
+              PKT.face = f & 3;
+              ++B->received;
+              sfbhost::dispatch(PKT);
+            }
+        }
+
+      sfbhost::runAlarms();
+      loop();
+    }
+  catch (u32)
+    { // The board rebooted
+      emuBoot();
+    }
+
+  if (EMU_NONE == B->done_at)
+    for (u32 i = 0; i < MAX_JOBS; ++i)
+      if ((NO_JOB != JOB_ARR[i].id) && (JOB_ARR[i].current_doa
+          >= JOB_ARR[i].doa))
+        {
+          B->done_at = sfbhost::now_us;
+          SHARED->done.fetch_add(1);
+          break;
+        }
+
+  u32 WHEN = 0;
+  u32 WAKE = (sfbhost::nextAlarm(WHEN) ? WHEN * 1000 : EMU_NONE);
+
+  for (u32 i = 0; i < 4; ++i)
+    if ((TX_QUEUE_ARR[i].count > 0) && ((EMU_NONE == WAKE) || ((s32) (WAKE
+        - sfbhost::now_us) > 1000)))
+      WAKE = sfbhost::now_us + 1000; // Back once the tokens or the batch deadline allow
+
+  B->wake_at.store(WAKE, std::memory_order_relaxed);
+  memcpy(STATE, __start_synergy_state, STATE_SIZE);
+
+  return;
+}
+
+/*
+ * Summary:     Claims and runs a board with work among a set of boards.
+ * Parameters:  u32 worker, bool whether to look outside its own share.
+ * Return:      bool true if it ran one.
+ */
+bool
+emuClaim(u32 WORKER, bool STEAL)
+{
+  u32 NOW = (u32) ((emuNow() - SHARED->start) / 1000);
+  bool RAN = false;
+
+  for (u32 i = 0; i < EMU_BOARDS; ++i)
+    {
+      EMU_BOARD *B = &BOARDS[i];
+      u32 FREE = EMU_FREE;
+
+      if ((STEAL == (WORKER == B->home)) || !emuReady(i, NOW))
+        continue;
+
+      if (!B->owner.compare_exchange_strong(FREE, WORKER + 1,
+          std::memory_order_acquire))
+        continue; // Somebody else got there first
+
+      u64 START = emuNow();
+
+      emuRun(i);
+      B->owner.store(EMU_FREE, std::memory_order_release);
+      WORKERS[WORKER].busy += emuNow() - START;
+      ++WORKERS[WORKER].runs;
+      WORKERS[WORKER].stolen += STEAL;
+      RAN = true;
+    }
+
+  return RAN;
+}
+
+/*
+ * Summary:     A worker process: runs its own boards, steals when they have
+ *              no work, rests when nobody has any.
+ * Parameters:  u32 worker.
+ * Return:      None.
+ */
+void
+emuWorker(u32 WORKER)
+{
+  long CPUS = sysconf(_SC_NPROCESSORS_ONLN);
+  cpu_set_t SET;
+
+  CPU_ZERO(&SET);
+  CPU_SET(WORKER % (CPUS > 0 ? CPUS : 1), &SET);
+  sched_setaffinity(0, sizeof(SET), &SET); // one worker per core where there are enough
+
+  sfbhost::sink = emuSink;
+  sfbhost::rebootHook = emuReboot;
+
+  while (!SHARED->stop.load(std::memory_order_relaxed))
+    if (!emuClaim(WORKER, false) && !emuClaim(WORKER, true))
+      {
+        struct timespec REST =
+          { 0, 100000 };
+
+        ++WORKERS[WORKER].idle;
+        nanosleep(&REST, 0);
+      }
+
+  return;
+}
+
+/*
+ * Summary:     Connects a face of one board to a face of another.
+ * Parameters:  u32 board, u8 face, u32 other board, u8 other face.
+ * Return:      None.
+ */
+void
+emuConnect(u32 A, u8 FACE_A, u32 B, u8 FACE_B)
+{
+  LINK_TO[A * 4 + FACE_A] = A * 4 + FACE_A;
+  LINK_FROM[B * 4 + FACE_B] = A * 4 + FACE_A;
+  LINK_TO[B * 4 + FACE_B] = B * 4 + FACE_B;
+  LINK_FROM[A * 4 + FACE_A] = B * 4 + FACE_B;
+
+  return;
+}
+
+/*
+ * Summary:     Maps memory every worker shares.
+ * Parameters:  size_t bytes.
+ * Return:      Zeroed memory.
+ */
+void *
+emuShare(size_t SIZE)
+{
+  void *p = mmap(0, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+      -1, 0);
+
+  if (MAP_FAILED == p)
+    {
+      perror("mmap");
+      exit(1);
+    }
+
+  return p;
+}
+
+/*
+ * Summary:     Prints the run's totals.
+ * Parameters:  u32 diameter, u32 time the run ended.
+ * Return:      None.
+ */
+void
+emuReport(u32 DIAMETER, u32 END)
+{
+  u32 FIRST = EMU_NONE;
+  u32 ALL = 0;
+  u64 RECEIVED = 0;
+  u64 DROPPED = 0;
+  u64 RUNS = 0;
+
+  for (u32 i = 0; i < EMU_BOARDS; ++i)
+    {
+      u32 AT = BOARDS[i].done_at;
+
+      if ((EMU_NONE != AT) && ((EMU_NONE == FIRST) || (AT < FIRST)))
+        FIRST = AT;
+
+      if (EMU_NONE == AT)
+        ALL = EMU_NONE;
+      else if ((EMU_NONE != ALL) && (AT > ALL))
+        ALL = AT;
+
+      RECEIVED += BOARDS[i].received;
+      DROPPED += BOARDS[i].dropped;
+      RUNS += BOARDS[i].runs;
+    }
+
+  double SECONDS = END / 1e6;
+
+  printf("GRID      %s of %u boards, diameter %u, %u workers (%s), ran %.3f s\n",
+      EMU_TOPOLOGY, EMU_BOARDS, DIAMETER, EMU_WORKERS, SAMPLE_NAME, SECONDS);
+
+  if (EMU_NONE == FIRST)
+    printf("ACCURACY  not reached\n");
+  else if (EMU_NONE == ALL)
+    printf("ACCURACY  first board %.3f s, not all boards\n", (FIRST
+        - SHARED->requested) / 1e6);
+  else
+    printf("ACCURACY  first board %.3f s, all boards %.3f s\n", (FIRST
+        - SHARED->requested) / 1e6, (ALL - SHARED->requested) / 1e6);
+
+  printf("PACKETS   %llu received (%.0f/s), %llu dropped on full rings\n",
+      (unsigned long long) RECEIVED, RECEIVED / SECONDS,
+      (unsigned long long) DROPPED);
+  printf("RUNS      %llu (%.0f/s)\n\n", (unsigned long long) RUNS, RUNS
+      / SECONDS);
+  printf("WORKER        RUNS     STOLEN       IDLE   BUSY\n");
+
+  for (u32 w = 0; w < EMU_WORKERS; ++w)
+    printf("%-6u%12llu%11llu%11llu%6.1f%%\n", w,
+        (unsigned long long) WORKERS[w].runs,
+        (unsigned long long) WORKERS[w].stolen,
+        (unsigned long long) WORKERS[w].idle, WORKERS[w].busy / (END * 10.0));
+
+  return;
+}
+
+int
+main(int argc, char ** argv)
+{
+  int OPT;
+
+  while ((OPT = getopt(argc, argv, "t:n:j:d:w:T:s:")) != -1)
+    switch (OPT)
+      {
+    case 't':
+      EMU_TOPOLOGY = optarg;
+      break;
+    case 'n':
+      EMU_BOARDS = atoi(optarg);
+      break;
+    case 'j':
+      EMU_WORKERS = atoi(optarg);
+      break;
+    case 'd':
+      sscanf(optarg, "%u.%u", &EMU_DOA1, &EMU_DOA2);
+      break;
+    case 'w':
+      EMU_WAIT = atoi(optarg);
+      break;
+    case 'T':
+      EMU_LIMIT = atoi(optarg);
+      break;
+    case 's':
+      EMU_SEED = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t line|ring|mesh|torus] [-n BOARDS] "
+        "[-j WORKERS] [-d DOA] [-w WAIT_MS] [-T LIMIT_S] [-s SEED]\n", argv[0]);
+      return 1;
+      }
+
+  if (!topologyKnown(EMU_TOPOLOGY))
+    {
+      fprintf(stderr, "emu:  Unknown topology %s.\n", EMU_TOPOLOGY);
+      return 1;
+    }
+
+  if ((EMU_BOARDS < 1) || (EMU_BOARDS > ARR_LENGTH))
+    {
+      fprintf(stderr, "emu:  %u boards won't fit tables of %u; raise "
+        "SYNERGY_ARR_LENGTH.\n", EMU_BOARDS, ARR_LENGTH);
+      return 1;
+    }
+
+  if (0 == EMU_WORKERS)
+    EMU_WORKERS = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (EMU_WORKERS > EMU_BOARDS)
+    EMU_WORKERS = EMU_BOARDS;
+
+  sampleSelect();
+  STATE_SIZE = __stop_synergy_state - __start_synergy_state;
+  PRISTINE.assign(__start_synergy_state, __stop_synergy_state);
+  LINK_TO.assign(EMU_BOARDS * 4, -1);
+  LINK_FROM.assign(EMU_BOARDS * 4, -1);
+
+  u32 DIAMETER = topologyLayout(EMU_TOPOLOGY, EMU_BOARDS, emuConnect);
+
+  SHARED = (EMU_SHARED *) emuShare(sizeof(EMU_SHARED));
+  BOARDS = (EMU_BOARD *) emuShare(EMU_BOARDS * sizeof(EMU_BOARD));
+  WORKERS = (EMU_WORKER *) emuShare(EMU_WORKERS * sizeof(EMU_WORKER));
+  RINGS = (EMU_RING *) emuShare(EMU_BOARDS * 5 * sizeof(EMU_RING));
+  STATES = (char *) emuShare(EMU_BOARDS * STATE_SIZE);
+
+  for (u32 i = 0; i < EMU_BOARDS; ++i)
+    {
+      BOARDS[i].wake_at.store(EMU_NONE);
+      BOARDS[i].done_at = EMU_NONE;
+      BOARDS[i].home = (u64) i * EMU_WORKERS / EMU_BOARDS;
+    }
+
+  SHARED->start = emuNow();
+  SHARED->requested = EMU_WAIT * 1000;
+
+  std::vector<pid_t> PIDS;
+
+  for (u32 w = 0; w < EMU_WORKERS; ++w)
+    {
+      pid_t PID = fork();
+
+      if (0 == PID)
+        {
+          emuWorker(w);
+          _exit(0);
+        }
+
+      if (PID < 0)
+        {
+          perror("fork");
+          SHARED->stop.store(1);
+          break;
+        }
+
+      PIDS.push_back(PID);
+    }
+
+  char REQUEST[32];
+  u32 LEN = snprintf(REQUEST, sizeof(REQUEST), "d%u.%u\n", EMU_DOA1, EMU_DOA2);
+  bool SENT = false;
+  u32 NOW = 0;
+
+  while (!SHARED->stop.load() && (SHARED->done.load() < EMU_BOARDS))
+    {
+      struct timespec REST =
+        { 0, 10000000 };
+
+      nanosleep(&REST, 0);
+      NOW = (u32) ((emuNow() - SHARED->start) / 1000);
+
+      if (!SENT && (NOW >= SHARED->requested))
+        { // Typed on board 0's terminal
+          SENT = emuPush(&RINGS[EMU_BOARDS * 4], REQUEST, LEN);
+          SHARED->requested = NOW;
+        }
+
+      if (SENT && (NOW - SHARED->requested > EMU_LIMIT * 1000000u))
+        break;
+    }
+
+  SHARED->stop.store(1);
+
+  for (u32 i = 0; i < PIDS.size(); ++i)
+    waitpid(PIDS[i], 0, 0);
+
+  emuReport(DIAMETER, NOW);
+
+  return 0;
+}
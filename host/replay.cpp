@@ -0,0 +1,290 @@
+/*
+ * Title:  replay
+ * Description:  Plays a packet trace captured with the 'w' command back into
+ * the synergy sketch on Linux.  The traced (r)esult records, (d)istribute
+ * requests and (p)ings are fed to their handlers, and the traced heartbeats
+ * drive heartBeat(), each at the millis() it was recorded at.  Between events
+ * loop() runs with the clock held still, so a replay always comes out the
+ * same.  Handler timings and the final node and job tables are printed.
+ *
+ * The board replayed is a fresh one: state from before the first traced
+ * event is not known, so capture from boot (or right after a 'w') for a
+ * faithful replay.  The board's own sampling uses the stub's random(), so its
+ * results differ from the traced board's but not between replays.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -Ihost host/replay.cpp -o replay
+ * Usage:
+ *   ./replay [trace file]      (standard input if left out)
+ */
+
+#include "sketch.h"
+#include "../synergy.cpp"
+#include "sample.h"
+
+#include <time.h>
+
+/*
+ * Summary:     Time spent replaying one kind of event
+ * Contains:    u32 events, u64 total and longest time in nanoseconds
+ */
+struct REPLAY_STAT
+{
+  u32 count; // events replayed
+  u64 total; // time across all events
+  u64 max; // longest event
+};
+
+REPLAY_STAT REPLAY_STAT_ARR[256]; // timings per event kind, and 'l' for loop()
+u32 REPLAY_TX_ARR[4]; // packets the replayed board sent per face
+u32 REPLAY_TRACED_TX = 0; // results the traced board sent
+
+/*
+ * Summary:     Counts the packets the replayed board sends.
+ * Parameters:  u8 face, bytes, u32 length.
+ * Return:      None.
+ */
+void
+replaySink(u8 face, const char * data, u32 len)
+{
+  for (u32 i = 0; i < len; ++i)
+    if ('\n' == data[i])
+      ++REPLAY_TX_ARR[face];
+
+  return;
+}
+
+/*
+ * Summary:     Reads the monotonic clock.
+ * Parameters:  None.
+ * Return:      u64 time in nanoseconds.
+ */
+u64
+replayNow()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (u64) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Summary:     Charges the time since START to an event kind.
+ * Parameters:  u8 kind, u64 start time in nanoseconds.
+ * Return:      None.
+ */
+void
+replayCharge(u8 KIND, u64 START)
+{
+  u64 TIME = replayNow() - START;
+  REPLAY_STAT *S = &REPLAY_STAT_ARR[KIND];
+
+  ++S->count;
+  S->total += TIME;
+
+  if (TIME > S->max)
+    S->max = TIME;
+
+  return;
+}
+
+/*
+ * Summary:     Parses a comma-separated base-36 field.
+ * Parameters:  Text cursor, moved past the field and its comma.
+ * Return:      u32 field value.
+ */
+u32
+replayField(const char ** CURSOR)
+{
+  u32 VALUE = 0;
+  const char * p = *CURSOR;
+
+  for (; *p && (',' != *p) && ('\n' != *p); ++p)
+    VALUE = VALUE * 36 + ((*p >= 'A') ? (u32) (*p - 'A' + 10) : (u32) (*p
+        - '0'));
+
+  *CURSOR = ((',' == *p) ? p + 1 : p);
+
+  return VALUE;
+}
+
+/*
+ * Summary:     Hands a packet to the replayed board's reflexes.
+ * Parameters:  u8 face, packet text.
+ * Return:      None.
+ */
+void
+replayPacket(u8 FACE, const char * TEXT)
+{
+  sfbhost::Packet PKT;
+
+  PKT.face = FACE;
+  PKT.len = strlen(TEXT);
+  memcpy(PKT.data, TEXT, PKT.len);
+  sfbhost::dispatch(PKT);
+
+  return;
+}
+
+/*
+ * Summary:     Replays one "T" line of a trace dump.
+ * Parameters:  Text of the line after the "T".
+ * Return:      None.
+ */
+void
+replayEvent(const char * LINE)
+{
+  u32 TIME = replayField(&LINE);
+  u8 KIND = LINE[0];
+  u8 FACE = LINE[1] - '0';
+
+  LINE += 2 + (',' == LINE[2]);
+
+  R_PKT PKT;
+
+  PKT.key.ID = replayField(&LINE);
+  PKT.key.TIME = replayField(&LINE);
+  PKT.job = replayField(&LINE);
+  PKT.weight = replayField(&LINE);
+  PKT.round = replayField(&LINE);
+  PKT.doa1 = replayField(&LINE);
+  PKT.doa2 = replayField(&LINE);
+  PKT.result = replayField(&LINE);
+
+  std::string ID = sfbhost::base36(PKT.key.ID);
+  std::string JOB = sfbhost::base36(PKT.job);
+  char TEXT[sfbhost::MAX_PACKET];
+
+  sfbhost::now_us = TIME * 1000;
+
+  u64 START = replayNow();
+
+  switch (KIND)
+    {
+  case 'r':
+    snprintf(TEXT, sizeof(TEXT), "r%s,%u,%s,%u,%u,%u.%u,%u\n", ID.c_str(),
+        PKT.key.TIME, JOB.c_str(), PKT.weight, PKT.round, PKT.doa1, PKT.doa2,
+        PKT.result);
+    replayPacket(FACE, TEXT);
+    break;
+  case 'd':
+    snprintf(TEXT, sizeof(TEXT), "d%u.%u,%u\n", PKT.doa1, PKT.doa2, PKT.weight);
+    replayPacket(FACE, TEXT);
+    break;
+  case 'p':
+    snprintf(TEXT, sizeof(TEXT), "p%s,%u\n", ID.c_str(), PKT.key.TIME);
+    replayPacket(FACE, TEXT);
+    break;
+  case 'h':
+    heartBeat(TIME);
+    break;
+  case 'o':
+    ++REPLAY_TRACED_TX; // only counted; the replayed board makes its own
+    return;
+  default:
+    fprintf(stderr, "replay:  Unknown event kind %c\n", KIND);
+    return;
+    }
+
+  replayCharge(KIND, START);
+
+  START = replayNow();
+  loop();
+  replayCharge('l', START);
+
+  return;
+}
+
+/*
+ * Summary:     Prints handler timings and the final state of the board.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+replayReport()
+{
+  const char * KINDS = "rdphl";
+
+  printf("EVENT     COUNT    TOTAL US     MEAN NS      MAX NS\n");
+
+  for (const char * k = KINDS; *k; ++k)
+    {
+      REPLAY_STAT *S = &REPLAY_STAT_ARR[(u8) *k];
+
+      printf("%c    %10u %11llu %11llu %11llu\n", *k, S->count,
+          (unsigned long long) (S->total / 1000),
+          (unsigned long long) (S->count ? S->total / S->count : 0),
+          (unsigned long long) S->max);
+    }
+
+  printf("\nRESULTS SENT  traced %u, replayed (packets per face) %u %u %u %u\n",
+      REPLAY_TRACED_TX, REPLAY_TX_ARR[0], REPLAY_TX_ARR[1], REPLAY_TX_ARR[2],
+      REPLAY_TX_ARR[3]);
+
+  printf("\nID        ACTIVE  TIME-STAMP   PINGS       RX      DUP     SPAM    STALE\n");
+
+  for (u32 i = 0; i < NODE_COUNT; ++i)
+    printf("%-10s%6c%12u%8u%9u%9u%9u%9u\n",
+        sfbhost::base36(ID_NODE_ARR[i]).c_str(), (nodeIn(ACTIVE_NODE_SET, i)
+            ? 'A' : 'I'), heardTime(i), NODE_ARR[i].pings, NODE_ARR[i].count.rx,
+        NODE_ARR[i].count.dup, NODE_ARR[i].count.spam,
+        NODE_ARR[i].count.stale);
+
+  printf("\nJOB       WEIGHT  ROUND      GOAL  ACHIEVED   PI ESTIMATE   RUN TIME\n");
+
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if (NO_JOB != JOB_ARR[i].id)
+      printf("%-10s%6u%7u%10.4f%10.4f%14.10f%11u\n", sfbhost::base36(
+          JOB_ARR[i].id).c_str(), JOB_ARR[i].weight, JOB_ARR[i].round,
+          JOB_ARR[i].doa, JOB_ARR[i].current_doa, JOB_ARR[i].calc_pi,
+          JOB_ARR[i].run_time);
+
+  return;
+}
+
+int
+main(int argc, char ** argv)
+{
+  FILE * IN = ((argc > 1) ? fopen(argv[1], "r") : stdin);
+  char LINE[256];
+  bool STARTED = false;
+
+  if (!IN)
+    {
+      perror(argv[1]);
+      return 1;
+    }
+
+  sfbhost::sink = replaySink;
+  sampleSelect();
+
+  while (fgets(LINE, sizeof(LINE), IN))
+    {
+      const char * p = LINE; // anything else on the terminal is passed over
+
+      if ('W' == *p)
+        { // A new dump: the board it came from
+          ++p;
+          sfbhost::bootId = replayField(&p);
+
+          if (!STARTED)
+            setup();
+
+          STARTED = true;
+        }
+
+      else if (('T' == *p) && STARTED)
+        replayEvent(p + 1);
+    }
+
+  if (!STARTED)
+    {
+      fprintf(stderr, "replay:  No trace found.\n");
+      return 1;
+    }
+
+  replayReport();
+
+  return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Title:  sample
+ * Description:  Vectorized versions of the sketch's sampling kernel,
+ * samplePoints(), for the host tools.  One vector register holds the
+ * SAMPLE_LANES random streams (two registers for the 4-wide SSE2 and NEON
+ * paths), so a step of every lane generates and tests SAMPLE_LANES points at
+ * once: a 16-bit multiply-high scales both halves of each random word to
+ * 0..RADIUS and a multiply-add of the halves with themselves gives x^2 + y^2.
+ * Counts are the same as the scalar kernel's on the same lanes.
+ *
+ * Include it after synergy.cpp and call sampleSelect() before the boards
+ * start: the widest kernel the CPU runs (AVX2, then SSE2 on x86; NEON on
+ * 64-bit ARM) is checked against the scalar one and, if they agree, put in
+ * SAMPLE_KERNEL.
+ */
+
+#ifndef SYNERGY_SAMPLE_H
+#define SYNERGY_SAMPLE_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SAMPLE_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SAMPLE_NEON
+#endif
+
+const u32 SAMPLE_CHECK = 1 << 16; // points the kernels are compared over
+
+const char * SAMPLE_NAME = "scalar"; // kernel sampleSelect() settled on
+
+#ifdef SAMPLE_X86
+
+/*
+ * Summary:     Steps four lanes of xorshift32 and counts their points inside.
+ * Parameters:  Lane states, in and out.
+ * Return:      __m128i of -1 for every point inside, 0 otherwise.
+ */
+__attribute__((target("sse2"))) static inline __m128i
+sampleSse2Step(__m128i * STATE)
+{
+  __m128i S = *STATE;
+
+  S = _mm_xor_si128(S, _mm_slli_epi32(S, 13));
+  S = _mm_xor_si128(S, _mm_srli_epi32(S, 17));
+  S = _mm_xor_si128(S, _mm_slli_epi32(S, 5));
+  *STATE = S;
+
+  __m128i XY = _mm_mulhi_epu16(S, _mm_set1_epi16(RADIUS + 1)); // x high, y low
+  __m128i SQUARED = _mm_madd_epi16(XY, XY); // x * x + y * y
+
+  return _mm_cmplt_epi32(SQUARED, _mm_set1_epi32(RADIUS_SQUARED + 1));
+}
+
+/*
+ * Summary:     samplePoints() with SSE2, two registers of four lanes.
+ * Parameters:  u32 lane states, u32 points (a multiple of SAMPLE_LANES).
+ * Return:      u32 points inside the circle.
+ */
+__attribute__((target("sse2"))) u32
+sampleSse2(u32 *LANE_ARR, u32 COUNT)
+{
+  __m128i LOW = _mm_loadu_si128((__m128i *) LANE_ARR);
+  __m128i HIGH = _mm_loadu_si128((__m128i *) (LANE_ARR + 4));
+  __m128i INSIDE = _mm_setzero_si128();
+
+  for (u32 i = 0; i < COUNT; i += SAMPLE_LANES)
+    { // Each inside point adds -1
+      INSIDE = _mm_add_epi32(INSIDE, sampleSse2Step(&LOW));
+      INSIDE = _mm_add_epi32(INSIDE, sampleSse2Step(&HIGH));
+    }
+
+  _mm_storeu_si128((__m128i *) LANE_ARR, LOW);
+  _mm_storeu_si128((__m128i *) (LANE_ARR + 4), HIGH);
+
+  u32 SUM[4];
+
+  _mm_storeu_si128((__m128i *) SUM, INSIDE);
+
+  return -(SUM[0] + SUM[1] + SUM[2] + SUM[3]);
+}
+
+/*
+ * Summary:     samplePoints() with AVX2, one register of eight lanes.
+ * Parameters:  u32 lane states, u32 points (a multiple of SAMPLE_LANES).
+ * Return:      u32 points inside the circle.
+ */
+__attribute__((target("avx2"))) u32
+sampleAvx2(u32 *LANE_ARR, u32 COUNT)
+{
+  __m256i S = _mm256_loadu_si256((__m256i *) LANE_ARR);
+  __m256i SCALE = _mm256_set1_epi16(RADIUS + 1);
+  __m256i LIMIT = _mm256_set1_epi32(RADIUS_SQUARED + 1);
+  __m256i INSIDE = _mm256_setzero_si256();
+
+  for (u32 i = 0; i < COUNT; i += SAMPLE_LANES)
+    {
+      S = _mm256_xor_si256(S, _mm256_slli_epi32(S, 13));
+      S = _mm256_xor_si256(S, _mm256_srli_epi32(S, 17));
+      S = _mm256_xor_si256(S, _mm256_slli_epi32(S, 5));
+
+      __m256i XY = _mm256_mulhi_epu16(S, SCALE);
+      __m256i SQUARED = _mm256_madd_epi16(XY, XY);
+
+      INSIDE = _mm256_add_epi32(INSIDE, _mm256_cmpgt_epi32(LIMIT, SQUARED));
+    }
+
+  _mm256_storeu_si256((__m256i *) LANE_ARR, S);
+
+  u32 SUM[8];
+
+  _mm256_storeu_si256((__m256i *) SUM, INSIDE);
+
+  return -(SUM[0] + SUM[1] + SUM[2] + SUM[3] + SUM[4] + SUM[5] + SUM[6]
+      + SUM[7]);
+}
+
+#endif
+
+#ifdef SAMPLE_NEON
+
+/*
+ * Summary:     Steps four lanes of xorshift32.
+ * Parameters:  Lane states, in and out.
+ * Return:      uint32x4_t of all ones for every point inside, 0 otherwise.
+ */
+static inline uint32x4_t
+sampleNeonStep(uint32x4_t * STATE)
+{
+  uint32x4_t S = *STATE;
+
+  S = veorq_u32(S, vshlq_n_u32(S, 13));
+  S = veorq_u32(S, vshrq_n_u32(S, 17));
+  S = veorq_u32(S, vshlq_n_u32(S, 5));
+  *STATE = S;
+
+  uint32x4_t X = vshrq_n_u32(vmulq_n_u32(vshrq_n_u32(S, 16), RADIUS + 1), 16);
+  uint32x4_t Y = vshrq_n_u32(vmulq_n_u32(vandq_u32(S, vdupq_n_u32(0xffff)),
+      RADIUS + 1), 16);
+  uint32x4_t SQUARED = vmlaq_u32(vmulq_u32(X, X), Y, Y);
+
+  return vcleq_u32(SQUARED, vdupq_n_u32(RADIUS_SQUARED));
+}
+
+/*
+ * Summary:     samplePoints() with NEON, two registers of four lanes.
+ * Parameters:  u32 lane states, u32 points (a multiple of SAMPLE_LANES).
+ * Return:      u32 points inside the circle.
+ */
+u32
+sampleNeon(u32 *LANE_ARR, u32 COUNT)
+{
+  uint32x4_t LOW = vld1q_u32(LANE_ARR);
+  uint32x4_t HIGH = vld1q_u32(LANE_ARR + 4);
+  uint32x4_t INSIDE = vdupq_n_u32(0);
+
+  for (u32 i = 0; i < COUNT; i += SAMPLE_LANES)
+    { // Each inside point adds all ones, i.e. -1
+      INSIDE = vaddq_u32(INSIDE, sampleNeonStep(&LOW));
+      INSIDE = vaddq_u32(INSIDE, sampleNeonStep(&HIGH));
+    }
+
+  vst1q_u32(LANE_ARR, LOW);
+  vst1q_u32(LANE_ARR + 4, HIGH);
+
+  return -vaddvq_u32(INSIDE);
+}
+
+#endif
+
+/*
+ * Summary:     Tells whether a kernel counts the same points as the scalar one
+ *              and leaves the lanes in the same state.
+ * Parameters:  Kernel.
+ * Return:      bool true if it does.
+ */
+bool
+sampleAgrees(SAMPLER KERNEL)
+{
+  u32 MINE[SAMPLE_LANES];
+  u32 THEIRS[SAMPLE_LANES];
+
+  for (u32 i = 0; i < SAMPLE_LANES; ++i)
+    MINE[i] = THEIRS[i] = 0x9e3779b9 * (i + 1);
+
+  for (u32 COUNT = SAMPLE_LANES; COUNT <= SAMPLE_CHECK; COUNT *= 2)
+    if (KERNEL(MINE, COUNT) != samplePoints(THEIRS, COUNT))
+      return false;
+
+  return !memcmp(MINE, THEIRS, sizeof(MINE));
+}
+
+/*
+ * Summary:     Puts the widest kernel the CPU runs in SAMPLE_KERNEL, falling
+ *              back to the scalar one if no other agrees with it.
+ * Parameters:  None.
+ * Return:      Name of the kernel chosen.
+ */
+const char *
+sampleSelect()
+{
+  SAMPLE_KERNEL = samplePoints;
+  SAMPLE_NAME = "scalar";
+
+  if (8 != SAMPLE_LANES)
+    return SAMPLE_NAME; // The vector kernels hold 8 lanes
+
+#ifdef SAMPLE_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2") && sampleAgrees(sampleAvx2))
+    {
+      SAMPLE_KERNEL = sampleAvx2;
+      SAMPLE_NAME = "avx2";
+    }
+
+  else if (__builtin_cpu_supports("sse2") && sampleAgrees(sampleSse2))
+    {
+      SAMPLE_KERNEL = sampleSse2;
+      SAMPLE_NAME = "sse2";
+    }
+#endif
+
+#ifdef SAMPLE_NEON
+  if (sampleAgrees(sampleNeon))
+    {
+      SAMPLE_KERNEL = sampleNeon;
+      SAMPLE_NAME = "neon";
+    }
+#endif
+
+  return SAMPLE_NAME;
+}
+
+#endif
@@ -0,0 +1,512 @@
+/*
+ * Title:  sfb
+ * Description:  Minimal host-side stand-in for the IXM SFB core API so the
+ * synergy sketch can be compiled and exercised on Linux.
+ */
+
+#ifndef SFB_HOST_H_GUARD
+#define SFB_HOST_H_GUARD
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#define ALL_FACES 0xff
+#define BODY_RGB_RED_PIN 0
+#define BODY_RGB_GREEN_PIN 1
+#define BODY_RGB_BLUE_PIN 2
+#define E_API_EQUAL 1
+#define B36_4(a,b,c,d) 0
+#define B36_6(a,b,c,d,e,f) 0
+
+#ifndef SFB_STATE
+#define SFB_STATE
+#endif
+
+namespace sfbhost
+{
+  typedef void (*Sink)(u8 face, const char * data, u32 len);
+  typedef void (*AlarmHandler)(u32 when);
+  typedef void (*ReflexHandler)(u8 * packet);
+  typedef void (*ZPrinter)(u8 face, void * arg, bool alt, int width,
+      bool zerofill);
+  typedef bool (*ZScanner)(u8 * packet, void * arg, bool alt, int width);
+
+  const u32 MAX_ALARMS = 16;
+  const u32 MAX_PACKET = 512;
+
+  struct Packet
+  {
+    u8 face;
+    u32 cursor;
+    u32 len;
+    char data[MAX_PACKET];
+  };
+
+  struct Alarm
+  {
+    AlarmHandler fn;
+    u32 when;
+    bool armed;
+  };
+
+  /* process-wide hooks, set by the harness */
+  u64 now_us = 0; // virtual clock in microseconds; millis() wraps as on a board
+  Sink sink = 0; // where outgoing bytes go
+  bool verbose = false; // echo logNormal to stderr
+  u32 bootId = 1; // getBootBlockBoardId() result
+  void (*rebootHook)() = 0;
+
+  /* per-board emulator state */
+  SFB_STATE Alarm alarms[MAX_ALARMS];
+  SFB_STATE u32 alarmCount = 0;
+  SFB_STATE u32 currentAlarm = 0;
+  SFB_STATE ReflexHandler reflexes[256];
+  SFB_STATE bool leds[3];
+  SFB_STATE u32 rngState = 0x9e3779b9;
+
+  inline void
+  emit(u8 face, const char * data, u32 len)
+  {
+    if (!len)
+      return;
+
+    if (ALL_FACES == face)
+      {
+        for (u8 f = 0; f < 4; ++f)
+          emit(f, data, len);
+        return;
+      }
+
+    if (face < 4 && sink)
+      sink(face, data, len);
+  }
+
+  inline void
+  pad(std::string & out, const std::string & s, int width, bool zero)
+  {
+    for (int i = (int) s.size(); i < width; ++i)
+      out += (zero ? '0' : ' ');
+    out += s;
+  }
+
+  inline std::string
+  base36(u32 v)
+  {
+    const char * digits = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char buf[16];
+    int n = 0;
+    do
+      {
+        buf[n++] = digits[v % 36];
+        v /= 36;
+      }
+    while (v);
+    std::string s;
+    while (n)
+      s += buf[--n];
+    return s;
+  }
+
+  inline void
+  vformat(u8 face, const char * fmt, va_list ap)
+  {
+    std::string out;
+    ZPrinter printer = 0;
+
+    for (const char * p = fmt; *p; ++p)
+      {
+        if ('%' != *p)
+          {
+            out += *p;
+            continue;
+          }
+
+        ++p;
+        bool zero = false;
+        int width = 0;
+
+        if ('0' == *p)
+          {
+            zero = true;
+            ++p;
+          }
+
+        while (*p >= '0' && *p <= '9')
+          width = width * 10 + (*p++ - '0');
+
+        char buf[64];
+
+        switch (*p)
+          {
+        case 'd':
+          snprintf(buf, sizeof(buf), "%d", va_arg(ap, int));
+          pad(out, buf, width, zero);
+          break;
+        case 'u':
+          snprintf(buf, sizeof(buf), "%u", va_arg(ap, unsigned));
+          pad(out, buf, width, zero);
+          break;
+        case 'x':
+          snprintf(buf, sizeof(buf), "%x", va_arg(ap, unsigned));
+          pad(out, buf, width, zero);
+          break;
+        case 't':
+          pad(out, base36(va_arg(ap, u32)), width, zero);
+          break;
+        case 'c':
+          out += (char) va_arg(ap, int);
+          break;
+        case 's':
+          pad(out, va_arg(ap, const char *), width, false);
+          break;
+        case 'f':
+          snprintf(buf, sizeof(buf), "%.*f", width ? width : 6,
+              va_arg(ap, double));
+          out += buf;
+          break;
+        case 'Z':
+          printer = va_arg(ap, ZPrinter);
+          break;
+        case 'z':
+          emit(face, out.data(), out.size());
+          out.clear();
+          printer(face, va_arg(ap, void *), false, width, zero);
+          break;
+        case '%':
+          out += '%';
+          break;
+        default:
+          return;
+          }
+      }
+
+    emit(face, out.data(), out.size());
+  }
+
+  inline Packet *
+  toPacket(u8 * packet)
+  {
+    return (Packet *) packet;
+  }
+
+  /* Splits a byte stream into packets and runs the matching reflex. */
+  inline void
+  dispatch(Packet & pkt)
+  {
+    pkt.cursor = 0;
+
+    if (pkt.len && reflexes[(u8) pkt.data[0]])
+      reflexes[(u8) pkt.data[0]]((u8 *) &pkt);
+  }
+
+  /* Fires every alarm due at or before the current clock; returns count. */
+  inline u32
+  runAlarms()
+  {
+    u32 fired = 0;
+    bool again = true;
+
+    while (again)
+      {
+        again = false;
+        u32 best = MAX_ALARMS;
+
+        for (u32 i = 0; i < alarmCount; ++i)
+          if (alarms[i].armed && (s32) (alarms[i].when - (u32) (now_us / 1000)) <= 0
+              && (MAX_ALARMS == best || (s32) (alarms[i].when
+                  - alarms[best].when) < 0))
+            best = i;
+
+        if (MAX_ALARMS != best)
+          {
+            alarms[best].armed = false;
+            currentAlarm = best;
+            alarms[best].fn(alarms[best].when);
+            ++fired;
+            again = true;
+          }
+      }
+
+    return fired;
+  }
+
+  /* Earliest armed alarm time in ms, or false when none is armed. */
+  inline bool
+  nextAlarm(u32 & when)
+  {
+    bool any = false;
+
+    for (u32 i = 0; i < alarmCount; ++i)
+      if (alarms[i].armed && (!any || (s32) (alarms[i].when - when) < 0))
+        {
+          when = alarms[i].when;
+          any = true;
+        }
+
+    return any;
+  }
+}
+
+struct SFBAlarms
+{
+  u32
+  create(sfbhost::AlarmHandler fn)
+  {
+    sfbhost::alarms[sfbhost::alarmCount].fn = fn;
+    sfbhost::alarms[sfbhost::alarmCount].armed = false;
+    return sfbhost::alarmCount++;
+  }
+
+  void
+  set(u32 alarm, u32 when)
+  {
+    sfbhost::alarms[alarm].when = when;
+    sfbhost::alarms[alarm].armed = true;
+  }
+
+  void
+  cancel(u32 alarm)
+  {
+    sfbhost::alarms[alarm].armed = false;
+  }
+
+  u32
+  currentAlarmNumber()
+  {
+    return sfbhost::currentAlarm;
+  }
+};
+
+struct SFBBody
+{
+  void
+  reflex(u8 code, sfbhost::ReflexHandler fn)
+  {
+    sfbhost::reflexes[code] = fn;
+  }
+};
+
+SFBAlarms Alarms;
+SFBBody Body;
+
+inline u32
+millis()
+{
+  return (u32) (sfbhost::now_us / 1000);
+}
+
+inline u32
+micros()
+{
+  return (u32) sfbhost::now_us;
+}
+
+inline void
+delay(u32 ms)
+{
+  sfbhost::now_us += ms * 1000;
+}
+
+inline void
+facePrintf(u8 face, const char * fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  sfbhost::vformat(face, fmt, ap);
+  va_end(ap);
+}
+
+inline void
+facePrintln(u8 face, const char * str)
+{
+  facePrintf(face, "%s\n", str);
+}
+
+inline void
+logNormal(const char * fmt, ...)
+{
+  if (!sfbhost::verbose)
+    return;
+
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+}
+
+inline u32
+packetScanf(u8 * packet, const char * fmt, ...)
+{
+  sfbhost::Packet * pkt = sfbhost::toPacket(packet);
+  sfbhost::ZScanner scanner = 0;
+  u32 matched = 0;
+  va_list ap;
+  va_start(ap, fmt);
+
+  for (const char * p = fmt; *p; ++p)
+    {
+      if ('%' != *p)
+        {
+          if (pkt->cursor >= pkt->len || pkt->data[pkt->cursor] != *p)
+            break;
+          ++pkt->cursor;
+          ++matched;
+          continue;
+        }
+
+      ++p;
+
+      if ('d' == *p || 'u' == *p)
+        {
+          u32 v = 0;
+          bool neg = false;
+          u32 start;
+
+          if (pkt->cursor < pkt->len && '-' == pkt->data[pkt->cursor])
+            {
+              neg = true;
+              ++pkt->cursor;
+            }
+
+          start = pkt->cursor;
+
+          while (pkt->cursor < pkt->len && pkt->data[pkt->cursor] >= '0'
+              && pkt->data[pkt->cursor] <= '9')
+            v = v * 10 + (pkt->data[pkt->cursor++] - '0');
+
+          if (start == pkt->cursor)
+            break;
+
+          *va_arg(ap, u32 *) = (neg ? (u32) -(s32) v : v);
+          ++matched;
+        }
+      else if ('t' == *p)
+        {
+          u32 v = 0;
+          u32 start = pkt->cursor;
+
+          while (pkt->cursor < pkt->len)
+            {
+              char c = pkt->data[pkt->cursor];
+              u32 d;
+
+              if (c >= '0' && c <= '9')
+                d = c - '0';
+              else if (c >= 'A' && c <= 'Z')
+                d = c - 'A' + 10;
+              else if (c >= 'a' && c <= 'z')
+                d = c - 'a' + 10;
+              else
+                break;
+
+              v = v * 36 + d;
+              ++pkt->cursor;
+            }
+
+          if (start == pkt->cursor)
+            break;
+
+          *va_arg(ap, u32 *) = v;
+          ++matched;
+        }
+      else if ('c' == *p)
+        {
+          if (pkt->cursor >= pkt->len)
+            break;
+          *va_arg(ap, u8 *) = pkt->data[pkt->cursor++];
+          ++matched;
+        }
+      else if ('Z' == *p)
+        scanner = va_arg(ap, sfbhost::ZScanner);
+      else if ('z' == *p)
+        {
+          if (!scanner(packet, va_arg(ap, void *), false, 0))
+            break;
+          ++matched;
+        }
+      else
+        break;
+    }
+
+  va_end(ap);
+  return matched;
+}
+
+inline u32
+packetCursor(u8 * packet)
+{
+  return sfbhost::toPacket(packet)->cursor;
+}
+
+inline u8
+packetSource(u8 * packet)
+{
+  return sfbhost::toPacket(packet)->face;
+}
+
+inline bool
+packetReread(u8 * packet)
+{
+  sfbhost::toPacket(packet)->cursor = 0;
+  return true;
+}
+
+inline void
+ledOn(u32 pin)
+{
+  sfbhost::leds[pin] = true;
+}
+
+inline void
+ledOff(u32 pin)
+{
+  sfbhost::leds[pin] = false;
+}
+
+inline bool
+ledIsOn(u32 pin)
+{
+  return sfbhost::leds[pin];
+}
+
+inline u32
+random(u32 lo, u32 hi)
+{
+  sfbhost::rngState ^= sfbhost::rngState << 13;
+  sfbhost::rngState ^= sfbhost::rngState >> 17;
+  sfbhost::rngState ^= sfbhost::rngState << 5;
+  return lo + sfbhost::rngState % (hi - lo);
+}
+
+inline u32
+getBootBlockBoardId()
+{
+  return sfbhost::bootId;
+}
+
+inline void
+reenterBootloader()
+{
+  if (sfbhost::rebootHook)
+    sfbhost::rebootHook();
+  else
+    abort();
+}
+
+#define API_ASSERT(cond, code) do { if (!(cond)) abort(); } while (0)
+#define API_ASSERT_NONNULL(p) API_ASSERT((p) != 0, 0)
+#define API_ASSERT_GREATER_EQUAL(a, b) API_ASSERT((s32) (a) >= (s32) (b), 0) // signed, as the blinkcode compares
+
+#endif
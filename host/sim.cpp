@@ -0,0 +1,623 @@
+/*
+ * Title:  sim
+ * Description:  Discrete-event simulation of a grid of IXM's running the
+ * synergy sketch, on a virtual clock.  Every board runs the real sketch: its
+ * state (everything marked SYNERGY_STATE or SFB_STATE) is gathered into the
+ * "synergy_state" section, and the engine swaps a board's copy of that
+ * section in before running any of its code.  Alarms (heartBeat, pingFaces,
+ * printTable, ...) fire at their virtual times, loop() runs after every
+ * event and while a board still has packets queued, and every packet crosses
+ * a modelled link with its own latency, bandwidth and loss.  Alarms may be
+ * made to fire up to -j microseconds late, as they do on a busy board.
+ *
+ * For each grid size a calculation is requested on board 0 and the run goes
+ * until every board reaches the requested accuracy (or the time limit).  One
+ * CSV line per size is printed: time to reach the accuracy (first board and
+ * all boards, from the request), packets and bytes by kind, packets lost,
+ * results dropped as spam, boards wrongly taken for idle ("leaves") and
+ * mean/max link utilization.  With -c the exit status is 1 if any run dropped
+ * a result as spam or saw a live board leave; run it well past the accuracy
+ * (-d 99.99 -T 30, say) to check that a sustained calculation stays inside
+ * the relay allowance.  Sizes beyond "ARR_LENGTH" need the tables raised,
+ * e.g. -DSYNERGY_ARR_LENGTH=256.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -Ihost host/sim.cpp -o sim
+ * Usage:
+ *   ./sim [-t line|ring|mesh|torus] [-n SIZE,SIZE,...] [-l LATENCY_US]
+ *         [-b BYTES_PER_S] [-p LOSS] [-d DOA] [-w WAIT_MS] [-T LIMIT_S]
+ *         [-j JITTER_US] [-s SEED] [-c]
+ */
+
+#define SYNERGY_STATE __attribute__((section("synergy_state")))
+#define SFB_STATE SYNERGY_STATE
+
+#include "sketch.h"
+#include "../synergy.cpp"
+#include "sample.h"
+#include "topology.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <queue>
+#include <vector>
+
+extern char __start_synergy_state[]; // provided by the linker
+extern char __stop_synergy_state[];
+
+const u32 SIM_NONE = 0xffffffff; // no event scheduled
+const u32 SIM_DELIVER = 0; // a packet arrives
+const u32 SIM_ALARM = 1; // a board's next alarm is due
+const u32 SIM_LOOP = 2; // a board has queued packets to send
+const u32 SIM_REQUEST = 3; // the calculation is requested
+
+/*
+ * Summary:     One direction of a link between two faces
+ * Contains:    Far board and face, time the link is busy until, totals
+ */
+struct SIM_LINK
+{
+  s32 to; // board on the far end, -1 if the face is unconnected
+  u8 face; // face on the far end
+  u32 busy; // time the last packet finishes going out
+  u64 busy_total; // time spent sending
+  u32 packets; // packets sent
+  u32 lost; // packets lost on the way
+};
+
+/*
+ * Summary:     A simulated board
+ * Contains:    Its copy of the sketch state, partial outgoing packets per
+ *              face, scheduled times, time it reached the accuracy
+ */
+struct SIM_BOARD
+{
+  std::vector<char> state; // its copy of the synergy_state section
+  std::string out[4]; // bytes of the packet being written on each face
+  u32 alarm_at; // time of its scheduled alarm event
+  u32 loop_at; // time of its scheduled loop event
+  u32 done_at; // time it reached the accuracy, SIM_NONE until then
+};
+
+/*
+ * Summary:     A scheduled event
+ * Contains:    Time, order of scheduling, kind, board, face, packet
+ */
+struct SIM_EVENT
+{
+  u32 at; // virtual time in microseconds
+  u64 seq; // breaks ties in scheduling order
+  u32 kind; // SIM_DELIVER, SIM_ALARM, SIM_LOOP, SIM_REQUEST
+  u32 board; // board it happens on
+  u8 face; // face a packet arrives on
+  std::string data; // packet bytes
+
+  bool
+  operator<(const SIM_EVENT & other) const
+  {
+    return ((at != other.at) ? (at > other.at) : (seq > other.seq));
+  }
+};
+
+/* configuration */
+const char * SIM_TOPOLOGY = "mesh"; // line, ring, mesh or torus
+u32 SIM_LATENCY = 1000; // microseconds a packet takes to cross a link
+u32 SIM_BANDWIDTH = 11520; // bytes per second a link carries (115200 baud)
+double SIM_LOSS = 0.0; // chance a packet is lost on a link
+u32 SIM_DOA1 = 99; // requested accuracy (whole portion)
+u32 SIM_DOA2 = 9; // requested accuracy (decimal portion)
+u32 SIM_WAIT = 5000; // milliseconds the grid gets to find itself before the request
+u32 SIM_LIMIT = 600; // seconds of virtual time before a run gives up
+u32 SIM_JITTER = 0; // most microseconds an alarm fires after its time
+u32 SIM_SEED = 1; // seed for loss and the boards' random()
+bool SIM_CHECK = false; // fail if a run drops results as spam or loses a live board
+
+/* run state */
+std::vector<SIM_BOARD> BOARDS;
+std::vector<SIM_LINK> LINKS; // board * 4 + face
+std::priority_queue<SIM_EVENT> EVENTS;
+std::vector<char> PRISTINE; // the section as the program started
+u64 SEQ = 0;
+s32 CURRENT = -1; // board whose state is in the section
+u32 DONE = 0; // boards that reached the accuracy
+u32 REQUESTED = SIM_NONE; // time the calculation was requested
+u64 RANDOM = 0; // state of the link model's random numbers
+u64 KIND_PACKETS[256]; // packets sent by first character
+u64 KIND_BYTES[256]; // bytes sent by first character
+u64 LEAVES = 0; // boards some board took for idle while they were running
+bool FAILED = false; // a checked run dropped results as spam or lost a live board
+
+/*
+ * Summary:     Schedules an event.
+ * Parameters:  u32 time, u32 kind, u32 board, u8 face, packet bytes.
+ * Return:      None.
+ */
+void
+simSchedule(u32 AT, u32 KIND, u32 BOARD, u8 FACE, const std::string & DATA)
+{
+  SIM_EVENT E;
+
+  E.at = AT;
+  E.seq = SEQ++;
+  E.kind = KIND;
+  E.board = BOARD;
+  E.face = FACE;
+  E.data = DATA;
+  EVENTS.push(E);
+
+  return;
+}
+
+/*
+ * Summary:     Swaps a board's state into the section.
+ * Parameters:  u32 board.
+ * Return:      None.
+ */
+void
+simEnter(u32 BOARD)
+{
+  size_t SIZE = __stop_synergy_state - __start_synergy_state;
+
+  if (CURRENT == (s32) BOARD)
+    return;
+
+  if (CURRENT >= 0)
+    memcpy(&BOARDS[CURRENT].state[0], __start_synergy_state, SIZE);
+
+  memcpy(__start_synergy_state, &BOARDS[BOARD].state[0], SIZE);
+  CURRENT = BOARD;
+
+  return;
+}
+
+/*
+ * Summary:     Cheap deterministic random number for the link model.
+ * Parameters:  None.
+ * Return:      double in [0, 1).
+ */
+double
+simRandom()
+{
+  RANDOM ^= RANDOM << 13;
+  RANDOM ^= RANDOM >> 7;
+  RANDOM ^= RANDOM << 17;
+
+  return (RANDOM >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * Summary:     Sends a packet across the link on a face of the current board.
+ * Parameters:  u8 face, packet bytes.
+ * Return:      None.
+ */
+void
+simTransmit(u8 FACE, const std::string & DATA)
+{
+  SIM_LINK *L = &LINKS[CURRENT * 4 + FACE];
+
+  if (L->to < 0)
+    return; // Nobody on that face
+
+  u32 NOW = sfbhost::now_us;
+  u32 START = (((s32) (L->busy - NOW) > 0) ? L->busy : NOW);
+  u32 SEND = (u32) ((u64) DATA.size() * 1000000 / SIM_BANDWIDTH);
+
+  L->busy = START + SEND;
+  L->busy_total += SEND;
+  ++L->packets;
+  ++KIND_PACKETS[(u8) DATA[0]];
+  KIND_BYTES[(u8) DATA[0]] += DATA.size();
+
+  if (simRandom() < SIM_LOSS)
+    {
+      ++L->lost;
+      return;
+    }
+
+  simSchedule(L->busy + SIM_LATENCY, SIM_DELIVER, L->to, L->face, DATA);
+
+  return;
+}
+
+/*
+ * Summary:     Collects the current board's output into packets.
+ * Parameters:  u8 face, bytes, u32 length.
+ * Return:      None.
+ */
+void
+simSink(u8 face, const char * data, u32 len)
+{
+  std::string & OUT = BOARDS[CURRENT].out[face];
+
+  for (u32 i = 0; i < len; ++i)
+    {
+      OUT += data[i];
+
+      if ('\n' == data[i])
+        {
+          simTransmit(face, OUT);
+          OUT.clear();
+        }
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Stands in for reenterBootloader(): the board starts over.
+ * Parameters:  None.
+ * Return:      None (unwinds to the engine).
+ */
+void
+simReboot()
+{
+  throw CURRENT;
+}
+
+/*
+ * Summary:     Boots a board from the pristine section.
+ * Parameters:  u32 board.
+ * Return:      None.
+ */
+void
+simBoot(u32 BOARD)
+{
+  simEnter(BOARD);
+  memcpy(__start_synergy_state, &PRISTINE[0], PRISTINE.size());
+  sfbhost::bootId = 1000 + BOARD;
+  sfbhost::rngState = SIM_SEED * 2654435761u + BOARD + 1;
+  setup();
+
+  return;
+}
+
+/*
+ * Summary:     Schedules the current board's next alarm and, while it has
+ *              packets queued, its next loop.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+simReschedule()
+{
+  SIM_BOARD *B = &BOARDS[CURRENT];
+  u32 NOW = sfbhost::now_us;
+  u32 WHEN = 0;
+
+  if (sfbhost::nextAlarm(WHEN) && ((SIM_NONE == B->alarm_at) || ((s32) (WHEN
+      * 1000 - B->alarm_at) < 0)))
+    {
+      B->alarm_at = (((s32) (WHEN * 1000 - NOW) > 0) ? WHEN * 1000 : NOW);
+
+      if (SIM_JITTER > 0) // The board is busy with something else
+        B->alarm_at += (u32) (simRandom() * SIM_JITTER);
+
+      simSchedule(B->alarm_at, SIM_ALARM, CURRENT, 0, "");
+    }
+
+  bool QUEUED = false;
+
+  for (u32 i = 0; i < 4; ++i)
+    QUEUED |= (TX_QUEUE_ARR[i].count > 0);
+
+  if (QUEUED && (SIM_NONE == B->loop_at))
+    { // Come back once the tokens or the batch deadline allow
+      B->loop_at = NOW + 1000;
+      simSchedule(B->loop_at, SIM_LOOP, CURRENT, 0, "");
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Runs one event on its board.
+ * Parameters:  Event.
+ * Return:      None.
+ */
+void
+simRun(const SIM_EVENT & E)
+{
+  SIM_BOARD *B = &BOARDS[E.board];
+
+  if ((SIM_ALARM == E.kind) && (E.at != B->alarm_at))
+    return; // Replaced by an earlier alarm
+
+  if ((SIM_LOOP == E.kind) && (E.at != B->loop_at))
+    return;
+
+  sfbhost::now_us = E.at;
+  simEnter(E.board);
+
+  u32 ACTIVE[NODE_WORDS]; // nodes active before the event
+
+  memcpy(ACTIVE, ACTIVE_NODE_SET, sizeof(ACTIVE));
+
+  try
+    {
+      if (SIM_ALARM == E.kind)
+        {
+          B->alarm_at = SIM_NONE;
+          sfbhost::runAlarms();
+        }
+
+      else if (SIM_LOOP == E.kind)
+        B->loop_at = SIM_NONE;
+
+      else
+        {
+          sfbhost::Packet PKT;
+
+          PKT.face = E.face;
+          PKT.len = E.data.size();
+          memcpy(PKT.data, E.data.data(), PKT.len);
+          sfbhost::dispatch(PKT);
+        }
+
+      loop();
+    }
+  catch (s32)
+    { // The board rebooted
+      B->alarm_at = B->loop_at = SIM_NONE;
+      simBoot(E.board);
+      memset(ACTIVE, 0, sizeof(ACTIVE)); // a reboot forgets its nodes, nobody left
+    }
+
+  for (u32 i = 0; i < NODE_WORDS; ++i) // No board is switched off, so every one
+    LEAVES += __builtin_popcount(ACTIVE[i] & ~ACTIVE_NODE_SET[i]); // gone idle is a false alarm
+
+  if (SIM_NONE == B->done_at)
+    for (u32 i = 0; i < MAX_JOBS; ++i)
+      if ((NO_JOB != JOB_ARR[i].id) && (JOB_ARR[i].current_doa
+          >= JOB_ARR[i].doa))
+        {
+          B->done_at = E.at;
+          ++DONE;
+          break;
+        }
+
+  simReschedule();
+
+  return;
+}
+
+/*
+ * Summary:     Connects a face of one board to a face of another.
+ * Parameters:  u32 board, u8 face, u32 other board, u8 other face.
+ * Return:      None.
+ */
+void
+simConnect(u32 A, u8 FACE_A, u32 B, u8 FACE_B)
+{
+  LINKS[A * 4 + FACE_A].to = B;
+  LINKS[A * 4 + FACE_A].face = FACE_B;
+  LINKS[B * 4 + FACE_B].to = A;
+  LINKS[B * 4 + FACE_B].face = FACE_A;
+
+  return;
+}
+
+/*
+ * Summary:     Lays out the links of a topology.
+ * Parameters:  u32 boards.
+ * Return:      u32 grid diameter in hops.
+ */
+u32
+simTopology(u32 N)
+{
+  SIM_LINK NONE =
+    { -1, 0, 0, 0, 0, 0 };
+
+  LINKS.assign(N * 4, NONE);
+
+  return topologyLayout(SIM_TOPOLOGY, N, simConnect);
+}
+
+/*
+ * Summary:     Simulates one grid size and prints its CSV line.
+ * Parameters:  u32 boards.
+ * Return:      None.
+ */
+void
+simGrid(u32 N)
+{
+  u32 DIAMETER = simTopology(N);
+  SIM_BOARD FRESH;
+
+  FRESH.state = PRISTINE;
+  FRESH.alarm_at = FRESH.loop_at = FRESH.done_at = SIM_NONE;
+  BOARDS.assign(N, FRESH);
+  EVENTS = std::priority_queue<SIM_EVENT>();
+  CURRENT = -1;
+  DONE = 0;
+  RANDOM = 0x9e3779b97f4a7c15ull ^ SIM_SEED; // each size runs as if alone
+  memset(KIND_PACKETS, 0, sizeof(KIND_PACKETS));
+  memset(KIND_BYTES, 0, sizeof(KIND_BYTES));
+  LEAVES = 0;
+
+  for (u32 i = 0; i < N; ++i)
+    { // Power up within the first few milliseconds
+      sfbhost::now_us = (u32) (simRandom() * 5000);
+      simBoot(i);
+      simReschedule();
+    }
+
+  char REQUEST[32];
+
+  snprintf(REQUEST, sizeof(REQUEST), "d%u.%u\n", SIM_DOA1, SIM_DOA2);
+  REQUESTED = SIM_WAIT * 1000;
+  simSchedule(REQUESTED, SIM_REQUEST, 0, 0, REQUEST);
+
+  clock_t WALL = clock();
+  u32 END = REQUESTED;
+
+  while (!EVENTS.empty() && (DONE < N))
+    {
+      SIM_EVENT E = EVENTS.top();
+
+      if ((E.at - REQUESTED) > SIM_LIMIT * 1000000u && (E.at > REQUESTED))
+        break;
+
+      EVENTS.pop();
+      END = E.at;
+      simRun(E);
+    }
+
+  u32 FIRST = SIM_NONE;
+  u32 ALL = 0;
+
+  for (u32 i = 0; i < N; ++i)
+    {
+      u32 AT = BOARDS[i].done_at;
+
+      if ((SIM_NONE != AT) && ((SIM_NONE == FIRST) || (AT < FIRST)))
+        FIRST = AT;
+
+      ALL = ((SIM_NONE == AT) ? SIM_NONE : ((SIM_NONE == ALL) ? ALL : ((AT
+          > ALL) ? AT : ALL)));
+    }
+
+  u64 LINK_COUNT = 0;
+  u64 LOST = 0;
+  double UTIL_SUM = 0.0;
+  double UTIL_MAX = 0.0;
+
+  for (u32 i = 0; i < LINKS.size(); ++i)
+    if (LINKS[i].to >= 0)
+      {
+        double UTIL = (double) LINKS[i].busy_total / (END ? END : 1);
+
+        ++LINK_COUNT;
+        LOST += LINKS[i].lost;
+        UTIL_SUM += UTIL;
+        UTIL_MAX = ((UTIL > UTIL_MAX) ? UTIL : UTIL_MAX);
+      }
+
+  u64 SPAM = 0;
+
+  for (u32 i = 0; i < N; ++i)
+    {
+      simEnter(i);
+
+      for (u32 j = 0; j < 4; ++j)
+        SPAM += FACE_COUNT_ARR[j].spam;
+    }
+
+  u64 PACKETS = 0;
+  u64 BYTES = 0;
+
+  for (u32 i = 0; i < 256; ++i)
+    {
+      PACKETS += KIND_PACKETS[i];
+      BYTES += KIND_BYTES[i];
+    }
+
+  printf("%s,%u,%u,", SIM_TOPOLOGY, N, DIAMETER);
+  printf((SIM_NONE == FIRST) ? "," : "%.3f,", (FIRST - REQUESTED) / 1e6);
+  printf((SIM_NONE == ALL) ? "," : "%.3f,", (ALL - REQUESTED) / 1e6);
+  printf("%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.4f,%.4f,%.3f,"
+    "%.3f\n",
+      (unsigned long long) PACKETS, (unsigned long long) BYTES,
+      (unsigned long long) (KIND_PACKETS['r'] + KIND_PACKETS['b']),
+      (unsigned long long) (KIND_BYTES['r'] + KIND_BYTES['b']),
+      (unsigned long long) (KIND_PACKETS['p'] + KIND_PACKETS['q']),
+      (unsigned long long) (KIND_BYTES['p'] + KIND_BYTES['q']),
+      (unsigned long long) KIND_PACKETS['x'], (unsigned long long) LOST,
+      (unsigned long long) SPAM, (unsigned long long) LEAVES,
+      (LINK_COUNT ? UTIL_SUM / LINK_COUNT : 0.0), UTIL_MAX, END / 1e6,
+      (double) (clock() - WALL) / CLOCKS_PER_SEC);
+  fflush(stdout);
+
+  if (SIM_CHECK && (SPAM || LEAVES))
+    {
+      fprintf(stderr, "sim:  %s of %u boards dropped %llu results as spam and "
+        "took %llu live boards for idle.\n", SIM_TOPOLOGY, N,
+          (unsigned long long) SPAM, (unsigned long long) LEAVES);
+      FAILED = true;
+    }
+
+  return;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const char * SIZES = "4,9,16,25";
+  int OPT;
+
+  while ((OPT = getopt(argc, argv, "t:n:l:b:p:d:w:T:j:s:c")) != -1)
+    switch (OPT)
+      {
+    case 't':
+      SIM_TOPOLOGY = optarg;
+      break;
+    case 'n':
+      SIZES = optarg;
+      break;
+    case 'l':
+      SIM_LATENCY = atoi(optarg);
+      break;
+    case 'b':
+      SIM_BANDWIDTH = atoi(optarg);
+      break;
+    case 'p':
+      SIM_LOSS = atof(optarg);
+      break;
+    case 'd':
+      sscanf(optarg, "%u.%u", &SIM_DOA1, &SIM_DOA2);
+      break;
+    case 'w':
+      SIM_WAIT = atoi(optarg);
+      break;
+    case 'T':
+      SIM_LIMIT = atoi(optarg);
+      break;
+    case 'j':
+      SIM_JITTER = atoi(optarg);
+      break;
+    case 's':
+      SIM_SEED = atoi(optarg);
+      break;
+    case 'c':
+      SIM_CHECK = true;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t line|ring|mesh|torus] [-n SIZE,...] "
+        "[-l LATENCY_US] [-b BYTES_PER_S] [-p LOSS] [-d DOA] [-w WAIT_MS] "
+        "[-T LIMIT_S] [-j JITTER_US] [-s SEED] [-c]\n", argv[0]);
+      return 1;
+      }
+
+  if (!topologyKnown(SIM_TOPOLOGY))
+    {
+      fprintf(stderr, "sim:  Unknown topology %s.\n", SIM_TOPOLOGY);
+      return 1;
+    }
+
+  sampleSelect();
+  PRISTINE.assign(__start_synergy_state, __stop_synergy_state);
+  sfbhost::sink = simSink;
+  sfbhost::rebootHook = simReboot;
+
+  printf("topology,boards,diameter,first_doa_s,all_doa_s,packets,bytes,"
+    "result_packets,result_bytes,ping_packets,ping_bytes,reboot_packets,"
+    "lost,spam,leaves,mean_link_util,max_link_util,sim_s,wall_s\n");
+
+  for (const char * p = SIZES; *p;)
+    {
+      u32 N = atoi(p);
+
+      if ((N < 1) || (N > ARR_LENGTH))
+        fprintf(stderr, "sim:  %u boards won't fit tables of %u; raise "
+          "SYNERGY_ARR_LENGTH.\n", N, ARR_LENGTH);
+      else
+        simGrid(N);
+
+      while (*p && (',' != *p))
+        ++p;
+
+      if (',' == *p)
+        ++p;
+    }
+
+  return (FAILED ? 1 : 0);
+}
@@ -0,0 +1,9 @@
+/*
+ * Title:  sketch
+ * Description:  Host stand-in for the sketch header the IXM build system puts
+ * together: the SFB stub followed by the synergy header.  Lets synergy.cpp be
+ * compiled into the Linux tools in this directory.
+ */
+
+#include "sfb.h"
+#include "../synergy.h"
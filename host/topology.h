@@ -0,0 +1,72 @@
+/*
+ * Title:  topology
+ * Description:  Grid layouts shared by the host tools that run many boards.
+ * Faces 0-3 are north, east, south and west; lines and rings use east and
+ * west only.  Meshes and tori fill rows of ceil(sqrt(N)) boards, the last row
+ * possibly short.
+ */
+
+#ifndef SYNERGY_TOPOLOGY_H
+#define SYNERGY_TOPOLOGY_H
+
+#include <math.h>
+#include <string.h>
+
+typedef void (*TOPOLOGY_CONNECT)(u32 A, u8 FACE_A, u32 B, u8 FACE_B);
+
+/*
+ * Summary:     Tells whether a topology name is known.
+ * Parameters:  Name.
+ * Return:      bool true for line, ring, mesh or torus.
+ */
+inline bool
+topologyKnown(const char * NAME)
+{
+  return (!strcmp(NAME, "line") || !strcmp(NAME, "ring") || !strcmp(NAME,
+      "mesh") || !strcmp(NAME, "torus"));
+}
+
+/*
+ * Summary:     Lays out the links of a topology.
+ * Parameters:  Name, u32 boards, function called once per link.
+ * Return:      u32 grid diameter in hops.
+ */
+inline u32
+topologyLayout(const char * NAME, u32 N, TOPOLOGY_CONNECT CONNECT)
+{
+  bool WRAP = (!strcmp(NAME, "ring") || !strcmp(NAME, "torus"));
+
+  if (!strcmp(NAME, "line") || !strcmp(NAME, "ring"))
+    {
+      for (u32 i = 0; i + 1 < N; ++i)
+        CONNECT(i, 1, i + 1, 3);
+
+      if (WRAP && (N > 2))
+        CONNECT(N - 1, 1, 0, 3);
+
+      return (WRAP ? N / 2 : N - 1);
+    }
+
+  u32 W = (u32) ceil(sqrt((double) N)); // columns
+  u32 H = (N + W - 1) / W; // rows; the last one may be short
+
+  for (u32 i = 0; i < N; ++i)
+    {
+      u32 x = i % W;
+      u32 y = i / W;
+
+      if ((x + 1 < W) && (i + 1 < N))
+        CONNECT(i, 1, i + 1, 3);
+      else if (WRAP && (x + 1 == W) && (W > 2))
+        CONNECT(i, 1, y * W, 3);
+
+      if (i + W < N)
+        CONNECT(i, 2, i + W, 0);
+      else if (WRAP && (H > 2) && (x < N - (H - 1) * W))
+        CONNECT(i, 2, x, 0);
+    }
+
+  return (WRAP ? W / 2 + H / 2 : (W - 1) + (H - 1));
+}
+
+#endif
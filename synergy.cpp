@@ -34,6 +34,36 @@
  *                followed by a combination of numbers and commas) and to start
  *                displaying the local IXM's internal table which will update on
  *                an interval
+ * >> s         - print the local IXM's network counters (packets received,
+ *                forwarded, and dropped as duplicates, spam, stale or
+ *                malformed, per face and per originating IXM) followed by
+ *                histograms of round duration and result arrival time
+ * >> c         - print the time spent in the handlers, the sampling kernel
+ *                and the packet printers/scanners: calls, min/mean/max and
+ *                percentiles in microseconds.  Only counted when built with
+ *                SYNERGY_PROFILE defined; otherwise the probes compile to
+ *                nothing
+ * >> mF[,N]     - stream one machine-readable record per N rounds of every
+ *                calculation (N is 1 if left out) instead of the table: F is
+ *                'c' for CSV lines or 'j' for JSON lines, and m0 stops the
+ *                stream.  A record holds the job, round, PI estimate (in units
+ *                of 1e-8), accuracy (in units of 1e-4 %), samples, active
+ *                nodes and run time, then the ID, result and age in ms of the
+ *                last packet of every node in the job.  Job and IXM ID's are
+ *                in base 36, so JSON gives them as strings.  Records of type K
+ *                carry absolute values; records of type D carry the change in
+ *                each of those values (nodes excepted) since the job's
+ *                previous record.  Every job opens with a K record and repeats
+ *                one every "TELEMETRY_KEYFRAME" records.
+ *                CSV: K,job,round,pi,accuracy,samples,active,time,nodes,id,result,age,...
+ *                JSON: {"t":"K","job":"..","round":..,"pi":..,"acc":..,
+ *                "samples":..,"active":..,"time":..,"nodes":[["id",result,age],..]}
+ * >> w         - print the local IXM's packet trace and start a new one.  Only
+ *                recorded when built with SYNERGY_TRACE defined: the newest
+ *                "TRACE_LENGTH" packets received ((r)esult records,
+ *                (d)istribute requests, (p)ings) and sent, and heartbeats,
+ *                each with its time and face.  host/replay.cpp plays a
+ *                captured trace back on Linux
  * >> dA.B        - request to initiate a calculation for the (A.B)_th degree of
  *                accuracy.  The result per round for PI (points IN circle) is
  *                broadcast the moment it is generated.  Replace the 'A.B' with
@@ -44,6 +74,10 @@
  *                within the boards as to how high of a degree of accuracy of PI
  *                they can take which can be found within the header file as
  *                "DOA_THRESHOLD".  Change this for endless calculating!
+ * >> dA.B,W      - same as above, but the calculation gets W shares of the
+ *                sampling (1 to "MAX_WEIGHT", 1 if left out).  Up to "MAX_JOBS"
+ *                calculations run side by side, each under its own job ID, and
+ *                a new one only pushes out a calculation that already finished.
  *
  * Notes:
  * The boards do not rely on a slave/master setup, meaning that every internal
@@ -54,6 +88,56 @@
  * Every additional board increases the total computation potential per round, thus
  * reducing the expected time to reach a projected degree of accuracy (but
  * probability likes to screw around from time to time).
+ * A board silent for longer than its idle limit leaves the synergy and every
+ * calculation it was part of, which go on without it.  The limit is learned
+ * from the spacing of its packets, but is never under "IDLE_MIN" (three
+ * heartbeats), or for a neighbor, the face's round trip and "IDLE_PINGS" face
+ * pings, so a dead neighbor is missed within half a second.
+ * Results relayed on a face are batched: up to "BATCH_SIZE" of them leave in
+ * one (b)atch packet ("b" followed by (r)esult records separated by ';') once
+ * that many are waiting or the oldest has waited "BATCH_DEADLINE" ms.  A lone
+ * result still goes out as a plain (r)esult packet.
+ * Rounds are pipelined: a board keeps sampling up to "ROUND_WINDOW" rounds
+ * ahead of the oldest one it has yet to compile, and compiles each round as soon
+ * as every board's result for it has arrived.  A board whose oldest round stalls
+ * across a heartbeat resends its results for the rest of the window.  Every
+ * packet of a board's own (new rounds, resends, heartbeats) is paid for from
+ * "SEND_BUCKET_DEPTH" tokens earned back one per "SEND_PERIOD" ms, which keeps
+ * it within what the relays forward per origin, so none of it is lost as spam.
+ *
+ * Host Tools:
+ * The host directory holds a stand-in for the SFB core (sfb.h) so the sketch
+ * can be built into Linux tools; they sample with the vectorized kernels in
+ * sample.h (AVX2 or SSE2 on x86, NEON on 64-bit ARM, picked at run time),
+ * which count the same points as the sketch's own.  Build them from the
+ * repository root:
+ * >> g++ -O2 -Ihost host/replay.cpp -o replay
+ *              - plays a trace captured with 'w' back into the sketch and
+ *                reports handler timings and the final node and job tables
+ * >> g++ -O2 -Ihost host/sim.cpp -o sim
+ *              - runs whole grids of sketches (line, ring, mesh or torus) on a
+ *                virtual clock over modelled links and prints, per grid size,
+ *                the time to reach the accuracy, traffic and link use as CSV;
+ *                -c fails the run if results were dropped as spam or a live
+ *                board was taken for idle (e.g. -d 99.99 -T 30 -c), and -j
+ *                makes alarms fire up to that many microseconds late
+ *                Grids beyond "ARR_LENGTH" boards need -DSYNERGY_ARR_LENGTH=N
+ * >> g++ -O2 -Ihost host/emu.cpp -o emu
+ *              - runs a grid of sketches in real time on every core: worker
+ *                processes share out the boards, steal each other's when idle
+ *                and pass packets over lock-free rings, then report the time
+ *                to reach the accuracy, packet rate and per-worker load
+ * >> g++ -O2 -Ihost host/bench.cpp -o bench
+ *              - times the hot functions (sampling, packet printing and
+ *                scanning, log(), sequence orders, compileResults(), table
+ *                refreshes) and writes CSV; -c compares with an earlier file
+ * >> g++ -O2 -Ihost host/aggregator.cpp -o aggregator
+ *              - a service for the Linux box on a board's terminal face: keeps
+ *                the global view of the grid (boards, jobs, rounds, a running
+ *                estimate over every result) from the packets on a serial
+ *                device, answers local clients on a Unix socket (s for text
+ *                tables, j for JSON, dA.B[,W] to request a calculation, x to
+ *                reboot the grid) and with -c samples as a board of the grid
  */
 
 #include "sketch.h"
@@ -89,123 +173,238 @@ setStatus(u32 STATUS)
 }
 
 /*
- * Summary:     Straightforward heapsort implementation.
- * Parameters:  u32 array, size of the array.
+ * Summary:     Tells whether a node is in a bitset of nodes.
+ * Parameters:  Bitset, u32 index of the node.
+ * Return:      Boolean confirming the node is in the set.
+ */
+bool
+nodeIn(const u32 *SET, u32 NODE_INDEX)
+{
+  return (SET[NODE_INDEX >> 5] >> (NODE_INDEX & 31)) & 1;
+}
+
+/*
+ * Summary:     Puts a node in a bitset of nodes or takes it out.
+ * Parameters:  Bitset, u32 index of the node, boolean whether it belongs.
  * Return:      None.
  */
 void
-heapsort(u32 arr[], u32 size)
+nodeMark(u32 *SET, u32 NODE_INDEX, bool IN)
 {
-  u32 i;
-  u32 elt;
-  u32 s;
-  u32 f;
-  u32 ivalue;
+  u32 BIT = 1u << (NODE_INDEX & 31);
 
-  for (i = 1; i < size; ++i)
-    {
-      elt = arr[i];
-      s = i;
-      f = (s - 1) / 2;
+  if (IN)
+    SET[NODE_INDEX >> 5] |= BIT;
+  else
+    SET[NODE_INDEX >> 5] &= ~BIT;
+
+  return;
+}
+
+/*
+ * Summary:     Works out a node's sequence order, its place by ID among a set
+ *              of nodes starting at 1.  Jobs hold on to the set rather than
+ *              the orders, so nothing needs sorting when one starts.
+ * Parameters:  Bitset of the sequenced nodes, u32 index of the node.
+ * Return:      u32 sequence order, 0 if the node isn't in the set.
+ */
+u32
+sequenceOrder(const u32 *SET, u32 NODE_INDEX)
+{
+  if (!nodeIn(SET, NODE_INDEX))
+    return 0;
+
+  u32 ORDER = 1;
+
+  for (u32 i = 0; i < NODE_COUNT; ++i) // every sequenced node with a lower ID
+    if (nodeIn(SET, i) && (ID_NODE_ARR[i] < ID_NODE_ARR[NODE_INDEX]))
+      ++ORDER; // goes before this one
+
+  return ORDER;
+}
+
+/*
+ * Summary:     Reads the host time a node was last heard from.  Times further
+ *              back than HEARD_SPAN when the base last moved read as that old.
+ * Parameters:  u32 index of the node.
+ * Return:      u32 host time.
+ */
+u32
+heardTime(u32 NODE_INDEX)
+{
+  return HEARD_BASE + NODE_ARR[NODE_INDEX].heard;
+}
+
+/*
+ * Summary:     Notes the host time a node is heard from, moving the base of
+ *              the last-heard times up first if the time no longer fits.
+ * Parameters:  u32 index of the node.
+ * Return:      None.
+ */
+void
+heardNow(u32 NODE_INDEX)
+{
+  u32 NOW = millis();
 
-      while ((s > 0) && (arr[f] < elt))
+  if (NOW - HEARD_BASE > 0xffff)
+    { // The offset won't fit; keep the last HEARD_SPAN exactly
+      u32 BASE = NOW - HEARD_SPAN;
+
+      for (u32 i = 0; i < NODE_COUNT; ++i)
         {
-          arr[s] = arr[f];
-          s = f;
-          f = (s - 1) / 2;
+          s32 SINCE = (s32) (heardTime(i) - BASE);
+
+          NODE_ARR[i].heard = ((SINCE > 0) ? SINCE : 0);
         }
 
-      arr[s] = elt;
+      HEARD_BASE = BASE;
     }
 
-  for (i = size - 1; i > 0; --i)
-    {
-      ivalue = arr[i];
-      arr[i] = arr[0];
-      f = 0;
-      s = ((1 == i) ? -1 : 1);
+  NODE_ARR[NODE_INDEX].heard = NOW - HEARD_BASE;
 
-      if ((i > 2) && arr[2] > arr[1])
-        s = 2;
+  return;
+}
 
-      while ((0 <= s) && (ivalue < arr[s]))
-        {
-          arr[f] = arr[s];
-          f = s;
-          s = 2 * f + 1;
+/*
+ * Summary:     Tells whether a node's result for a round of a job is in.  Only
+ *              rounds from the oldest one not compiled onwards are kept.
+ * Parameters:  Job, u32 index of the node, u32 round.
+ * Return:      Boolean confirming the result is in.
+ */
+bool
+heldResult(struct JOB *J, u32 NODE_INDEX, u32 ROUND)
+{
+  if ((ROUND < J->round) || (ROUND - J->round >= ROUND_SLOTS))
+    return false; // Compiled already or not reached yet
 
-          if ((s + 1) <= (i - 1) && (arr[s] < arr[s + 1]))
-            ++s;
+  return nodeIn(J->held_set[ROUND % ROUND_SLOTS], NODE_INDEX);
+}
 
-          if (s > i - 1)
-            s = -1;
-        }
+/*
+ * Summary:     Looks up the host's own result for a round of a job, which it
+ *              keeps until a later round takes over the slot.
+ * Parameters:  Job, u32 round.
+ * Return:      u32 result, 0 if the host's result for that round isn't held.
+ */
+u32
+ownResult(struct JOB *J, u32 ROUND)
+{
+  u32 SLOT = ROUND % ROUND_SLOTS;
 
-      arr[f] = ivalue;
-    }
+  if ((u16) ROUND != J->own_round_arr[SLOT])
+    return 0; // The slot is empty or holds another round
+
+  return J->own_arr[SLOT];
 }
 
 /*
- * Summary:     Assign sequence numbers to nodes according to ID.
- * Parameters:  None.
- * Return:      None.
+ * Summary:     Reads the round of a node's newest result for a job.  Shares
+ *              keep the low 16 bits of it, which is enough as none is left
+ *              further than SHARE_SPAN + SHARE_SWEEP rounds behind the job.
+ * Parameters:  Job, u32 index of the node.
+ * Return:      u32 round, 0 if no result of the node is shown.
  */
-void
-sequenceNodes()
+u32
+shareRound(struct JOB *J, u32 NODE_INDEX)
 {
-  heapsort(ACTIVE_ID_NODE_ARR, ACTIVE_NODE_COUNT); // sort the IXM ID's
+  struct SHARE *SHARE = &J->share_arr[NODE_INDEX];
 
-  for (u32 i = 0; i < NODE_COUNT; ++i) // Try to match every ID
-    for (u32 j = 0; j < ACTIVE_NODE_COUNT; ++j) // with every active ID
-      if (ID_NODE_ARR[i] == ACTIVE_ID_NODE_ARR[j]) // and if there's a match
-        SEQ_NODE_ARR[i] = j + 1; // assign it a sequence number starting at 1
+  if (0 == SHARE->result)
+    return 0; // 0 is never a correct answer, so the share is empty
 
-  return;
+  return J->round + (s16) (SHARE->round - (u16) J->round);
 }
 
 /*
- * Summary:     Clears out relevant data for a new round.
- * Parameters:  None.
+ * Summary:     Tells whether the host should sample the next round of a job:
+ *              while the goal isn't reached, whenever the window has room, and
+ *              after that only for rounds another board has sampled already,
+ *              as some board that is still working will want them.
+ * Parameters:  Job.
+ * Return:      Boolean confirming the round is wanted.
+ */
+bool
+roundWanted(struct JOB *J)
+{
+  if (J->sample_round - J->round >= ROUND_WINDOW)
+    return false; // The window is full
+
+  if (J->current_doa < J->doa)
+    return true;
+
+  u32 *HELD = J->held_set[J->sample_round % ROUND_SLOTS];
+
+  for (u32 i = 0; i < NODE_WORDS; ++i)
+    if (0 != (HELD[i] & ((0 == i) ? ~1u : ~0u))) // any board but the host
+      return true;
+
+  return false;
+}
+
+/*
+ * Summary:     Moves a job on to its next round once the oldest is complete.
+ *              The slot of the old round is emptied for the round that takes
+ *              it over, and every SHARE_SWEEP rounds the nodes' newest results
+ *              that fell more than SHARE_SPAN rounds behind stop being shown.
+ * Parameters:  Job moving on to its next round.
  * Return:      None.
  */
 void
-roundFlush()
+roundFlush(struct JOB *J)
 {
-  HOST_RESULT = 0; // running total of points within the circle
-  POINTS_GEN = 0; // running total of all points within the square
-  ++HOST_ROUND; // Indicator that host is ready for next round
+  u32 SLOT = J->round % ROUND_SLOTS;
 
-  for (u32 i = 1; i < ARR_LENGTH; ++i) // since the compiled result has been used
-    RESULT_NODE_ARR[i] = 0; // clear everything but the host result (needed for heartbeat)
+  memset(J->held_set[SLOT], 0, sizeof(J->held_set[SLOT]));
+  J->sum_arr[SLOT] = 0;
+  J->count_arr[SLOT] = 0;
+
+  ++J->round; // Indicator that host is ready for next round
+  J->round_start = millis();
+
+  if (roundWanted(J)) // and that the window has room for one more
+    J->tx_flag = true;
+
+  if (0 == J->round % SHARE_SWEEP)
+    for (u32 i = 0; i < NODE_COUNT; ++i)
+      if ((0 != J->share_arr[i].result) && ((s32) (J->round
+          - shareRound(J, i)) > (s32) SHARE_SPAN))
+        J->share_arr[i].result = 0; // before its round's low bits could pass for a newer one
 }
 
 /*
  * Summary:     Clears out relevant data for an entirely new degree of accuracy.
- * Parameters:  None.
+ * Parameters:  Job taking over a slot in the job table.
  * Return:      None.
  */
 void
-calcFlush()
+calcFlush(struct JOB *J)
 {
-  HOST_CURRENT_DOA = 0.0; // accuracy achieved since last round
-  RESULT_COMPILED = 0; // total dots for this round
-  RUN_TIME_START = millis(); // calculation initialization time
-  RUN_TIME = 0; // time it took to achieve desired accuracy
-  POINTS_GEN = 0; // running total of all points within the square
-  HOST_RESULT = 0; // running total of points within the circle
-  TOTAL_CIRCLE_COUNT = 0; // reset the running count
-  CALC_PI = 0; // clear out any stored derivations of pi
-  HOST_DOA = 0.0; // degree of accuracy
-  HOST_ROUND = 1; // Indicator that the rounds have begun again
-
-  for (u32 i = 1; i < ARR_LENGTH; ++i) // since the compiled result has been used
-    {
-      RESULT_NODE_ARR[i] = 0; // clear everything but the host result (needed for heartbeat)
-      SEQ_NODE_ARR[i] = 0;
-      ROUND_NODE_ARR[i] = 0;
-    }
-
-  sequenceNodes(); // resequence the nodes for every new calculation
+  J->current_doa = 0.0; // accuracy achieved since last round
+  J->run_time_start = millis(); // calculation initialization time
+  J->run_time = 0; // time it took to achieve desired accuracy
+  J->points_gen = 0; // running total of all points within the square
+  J->result = 0; // running total of points within the circle
+  J->total_circle_count = 0; // reset the running count
+  J->total_points = 0;
+  J->calc_pi = 0; // clear out any stored derivations of pi
+  J->doa = 0.0; // degree of accuracy
+  J->round = 1; // Indicator that the rounds have begun again
+  J->sample_round = 1;
+  J->compiled = 0;
+  J->round_start = J->run_time_start;
+  J->beat_round = J->answer_time = 0;
+  J->records = 0; // open the job's telemetry with absolute values
+  J->tx_flag = true; // start sampling right away
+
+  memset(J->held_set, 0, sizeof(J->held_set)); // nothing carries over from the slot's previous job
+  memset(J->sum_arr, 0, sizeof(J->sum_arr));
+  memset(J->count_arr, 0, sizeof(J->count_arr));
+  memset(J->own_arr, 0, sizeof(J->own_arr));
+  memset(J->own_round_arr, 0, sizeof(J->own_round_arr));
+  memset(J->share_arr, 0, sizeof(J->share_arr));
+
+  memcpy(J->seq_set, ACTIVE_NODE_SET, sizeof(J->seq_set)); // hold the job to the nodes active now
+  J->node_count = ACTIVE_NODE_COUNT;
 
   setStatus(BLUE); // It's calculating time!
 
@@ -213,7 +412,8 @@ calcFlush()
 }
 
 /*
- * Summary:     Custom (d)istribute packet scanner.
+ * Summary:     Custom (d)istribute packet scanner.  The weight is optional and
+ *              defaults to 1.
  * Parameters:  The arguments are automatically handled within a parent
  *              header file.
  * Return:      Boolean confirming the packet was read correctly.
@@ -221,9 +421,13 @@ calcFlush()
 bool
 D_ZScanner(u8 * packet, void * arg, bool alt, int width)
 {
+  PROFILE(PROBE_D_ZSCANNER);
+
   /* (d)istribute packet structure */
   u32 DOA1; // integer degree of accuracy (whole portion)
   u32 DOA2; // integer degree of accuracy (decimal portion)
+  u32 WEIGHT = 1; // integer share of the sampling
+  u32 MATCHED;
 
   if (packetScanf(packet, "%d.%d", &DOA1, &DOA2) != 3)
     {
@@ -232,11 +436,19 @@ D_ZScanner(u8 * packet, void * arg, bool alt, int width)
       return false;
     }
 
+  if (((MATCHED = packetScanf(packet, ",%d", &WEIGHT)) != 0) && (MATCHED != 2))
+    {
+      logNormal("Inconsistent weight for (d)istribute packet.\n");
+
+      return false;
+    }
+
   if (arg)
     {
       D_PKT * PKT_R = (D_PKT*) arg;
       PKT_R->doa1 = DOA1;
       PKT_R->doa2 = DOA2;
+      PKT_R->weight = WEIGHT;
     }
 
   return true;
@@ -251,12 +463,15 @@ D_ZScanner(u8 * packet, void * arg, bool alt, int width)
 void
 R_ZPrinter(u8 face, void * arg, bool alt, int width, bool zerofill)
 {
+  PROFILE(PROBE_R_ZPRINTER);
+
   API_ASSERT_NONNULL(arg);
 
   R_PKT PKT_T = *(R_PKT*) arg;
 
-  facePrintf(face, "%t,%d,%d,%d,%d.%d,%d", PKT_T.key.ID, PKT_T.key.TIME,
-      PKT_T.doa_ver, PKT_T.round, PKT_T.doa1, PKT_T.doa2, PKT_T.result);
+  facePrintf(face, "%t,%d,%t,%d,%d,%d.%d,%d", PKT_T.key.ID, PKT_T.key.TIME,
+      PKT_T.job, PKT_T.weight, PKT_T.round, PKT_T.doa1, PKT_T.doa2,
+      PKT_T.result);
 
   return;
 }
@@ -270,17 +485,20 @@ R_ZPrinter(u8 face, void * arg, bool alt, int width, bool zerofill)
 bool
 R_ZScanner(u8 * packet, void * arg, bool alt, int width)
 {
+  PROFILE(PROBE_R_ZSCANNER);
+
   /* (r)esult packet structure */
   u32 ID; // hex ID (board key)
   u32 TIME; // integer timestamp (packet key)
+  u32 JOB_ID; // hex job ID
+  u32 WEIGHT; // integer job weight
   u32 DOA1; // integer degree of accuracy (whole portion)
   u32 DOA2; // integer degree of accuracy (decimal portion)
-  u32 DOA_VER; // integere DOA version
   u32 RSLT; // integer result
   u32 RSLT_VER; // integer result version
 
-  if (packetScanf(packet, "%t,%d,%d,%d,%d.%d,%d", &ID, &TIME, &DOA_VER,
-      &RSLT_VER, &DOA1, &DOA2, &RSLT) != 13)
+  if (packetScanf(packet, "%t,%d,%t,%d,%d,%d.%d,%d", &ID, &TIME, &JOB_ID,
+      &WEIGHT, &RSLT_VER, &DOA1, &DOA2, &RSLT) != 15)
     {
       logNormal("Inconsistent packet format for (r)esult packet.\n");
       return false;
@@ -291,7 +509,8 @@ R_ZScanner(u8 * packet, void * arg, bool alt, int width)
       R_PKT * PKT_R = (R_PKT*) arg;
       PKT_R->key.ID = ID;
       PKT_R->key.TIME = TIME;
-      PKT_R->doa_ver = DOA_VER;
+      PKT_R->job = JOB_ID;
+      PKT_R->weight = WEIGHT;
       PKT_R->round = RSLT_VER;
       PKT_R->doa1 = DOA1;
       PKT_R->doa2 = DOA2;
@@ -301,6 +520,206 @@ R_ZScanner(u8 * packet, void * arg, bool alt, int width)
   return true;
 }
 
+#ifdef SYNERGY_TRACE
+/*
+ * Summary:     Adds an event to the packet trace, overwriting the oldest one
+ *              once the trace is full.
+ * Parameters:  u8 kind of event, u8 face, packet contents or 0.
+ * Return:      None.
+ */
+void
+traceEvent(u8 KIND, u8 FACE, struct R_PKT *PKT)
+{
+  struct TRACE *T = &TRACE_ARR[TRACE_COUNT++ % TRACE_LENGTH];
+
+  T->time = millis();
+  T->kind = KIND;
+  T->face = FACE;
+
+  if (PKT)
+    T->pkt = *PKT;
+  else
+    memset(&T->pkt, 0, sizeof(T->pkt));
+
+  return;
+}
+#endif
+
+/*
+ * Summary:     Tops up a token bucket with the tokens earned since last time.
+ * Parameters:  Token bucket, u32 depth of the bucket, u32 time to earn a token.
+ * Return:      u32 tokens in the bucket.
+ */
+u32
+bucketLevel(struct TOKEN_BUCKET *BKT, u32 DEPTH, u32 PERIOD)
+{
+  u32 NOW = millis();
+  u32 EARNED = (NOW - BKT->stamp) / PERIOD; // tokens earned since the last refill
+
+  if (EARNED >= DEPTH - BKT->tokens)
+    { // a full bucket doesn't keep earning
+      BKT->tokens = DEPTH;
+      BKT->stamp = NOW;
+    }
+
+  else if (EARNED > 0)
+    {
+      BKT->tokens += EARNED;
+      BKT->stamp += EARNED * PERIOD; // keep the remainder towards the next token
+    }
+
+  return BKT->tokens;
+}
+
+/*
+ * Summary:     Tops up a token bucket and hands out a token if one is left.
+ * Parameters:  Token bucket, u32 depth of the bucket, u32 time to earn a token.
+ * Return:      Boolean confirming a token was taken.
+ */
+bool
+bucketTake(struct TOKEN_BUCKET *BKT, u32 DEPTH, u32 PERIOD)
+{
+  if (0 == bucketLevel(BKT, DEPTH, PERIOD))
+    return false; // Over the limit
+
+  --BKT->tokens;
+
+  return true;
+}
+
+/*
+ * Summary:     Refills a token bucket to its full depth.
+ * Parameters:  Token bucket, u32 depth of the bucket.
+ * Return:      None.
+ */
+void
+bucketFill(struct TOKEN_BUCKET *BKT, u32 DEPTH)
+{
+  BKT->tokens = DEPTH;
+  BKT->stamp = millis();
+
+  return;
+}
+
+/*
+ * Summary:     Queues a (r)esult packet for a face.  A waiting packet from the
+ *              same IXM, job and round is superseded, and a full queue gives up
+ *              its oldest relay for a fresh result before anything else is
+ *              lost.
+ *              Packets from one IXM always leave in the order they came.
+ * Parameters:  u32 face, (r)esult packet, u8 priority (PRIO_FRESH, PRIO_RELAY).
+ * Return:      Boolean confirming the packet was queued.
+ */
+bool
+enqueueR_PKT(u32 face, struct R_PKT *PKT_T, u8 PRIO)
+{
+  TX_QUEUE *Q = &TX_QUEUE_ARR[face];
+  u32 i;
+
+  for (i = 0; i < Q->count; ++i)
+    if ((Q->pkt[i].key.ID == PKT_T->key.ID) && (Q->pkt[i].job == PKT_T->job)
+        && (Q->pkt[i].round == PKT_T->round))
+      { // Coalesce with the older packet from the same IXM, job and round
+        if (Q->prio[i] > PRIO)
+          PRIO = Q->prio[i];
+
+        for (; i + 1 < Q->count; ++i)
+          { // but queue up behind the rest so packets from one IXM stay in order
+            Q->pkt[i] = Q->pkt[i + 1];
+            Q->prio[i] = Q->prio[i + 1];
+          }
+
+        --Q->count;
+
+        break;
+      }
+
+  if (Q->count >= TX_QUEUE_LENGTH)
+    { // Make room by dropping the oldest packet of lower priority
+      for (i = 0; i < Q->count; ++i)
+        if (Q->prio[i] < PRIO)
+          break;
+
+      if (i == Q->count)
+        return false; // Nothing less important to drop
+
+      for (; i + 1 < Q->count; ++i)
+        {
+          Q->pkt[i] = Q->pkt[i + 1];
+          Q->prio[i] = Q->prio[i + 1];
+        }
+
+      --Q->count;
+    }
+
+  if (0 == Q->count)
+    Q->since = millis(); // a new batch starts filling
+
+  Q->pkt[Q->count] = *PKT_T;
+  Q->prio[Q->count] = PRIO;
+  ++Q->count;
+
+  return true;
+}
+
+/*
+ * Summary:     Sends queued packets while each face still has tokens.  Up to
+ *              BATCH_SIZE results leave together in one (b)atch packet, once
+ *              that many are waiting or the oldest has waited BATCH_DEADLINE.
+ *              Fresh results leave before relays.
+ * Parameters:  None.
+ * Return:      None.
+ */
+void
+flushQueues()
+{
+  PROFILE(PROBE_FLUSH_QUEUES);
+
+  for (u32 face = 0; face < 4; ++face)
+    {
+      TX_QUEUE *Q = &TX_QUEUE_ARR[face];
+
+      while (Q->count > 0)
+        {
+          if ((Q->count < BATCH_SIZE) && ((millis() - Q->since) < BATCH_DEADLINE))
+            break; // Let the batch fill up a little longer
+
+          if (!bucketTake(&FACE_BUCKET_ARR[face], FACE_BUCKET_DEPTH,
+              FACE_REFILL_PERIOD))
+            break; // A whole batch costs a single token
+
+          u32 RECORDS = ((Q->count < BATCH_SIZE) ? Q->count : BATCH_SIZE);
+
+          facePrintf(face, ((1 == RECORDS) ? "r" : "b")); // a lone result needs no batch
+
+          for (u32 n = 0; n < RECORDS; ++n)
+            {
+              u32 next = 0; // oldest packet of the highest priority
+
+              for (u32 i = 1; i < Q->count; ++i)
+                if (Q->prio[i] > Q->prio[next])
+                  next = i;
+
+              facePrintf(face, "%s%Z%z", (n ? ";" : ""), R_ZPrinter,
+                  &Q->pkt[next]);
+              TRACE_EVENT('o', face, &Q->pkt[next]);
+
+              for (u32 i = next; i + 1 < Q->count; ++i)
+                {
+                  Q->pkt[i] = Q->pkt[i + 1];
+                  Q->prio[i] = Q->prio[i + 1];
+                }
+
+              --Q->count;
+            }
+
+          facePrintf(face, "\n");
+        }
+    }
+
+  return;
+}
+
 /*
  * Summary:     Broadcasts the received packet to the neighboring nodes
  *              save for the terminal face if it is known.
@@ -312,7 +731,7 @@ BRD_R_PKT(struct R_PKT *PKT_T)
 {
   for (u32 i = 0; i < 4; ++i) // Forward received packet to neighboring nodes
     if (TERMINAL_FACE != i) // but don't forward to the terminal face
-      facePrintf(i, "r%Z%z\n", R_ZPrinter, PKT_T);
+      enqueueR_PKT(i, PKT_T, PRIO_FRESH);
 
   return;
 }
@@ -326,9 +745,11 @@ BRD_R_PKT(struct R_PKT *PKT_T)
 void
 FWD_R_PKT(struct R_PKT *PKT_T, u8 face)
 {
+  PROFILE(PROBE_FWD_R_PKT);
+
   for (u32 i = 0; i < 4; ++i) // Forward received packet to neighboring nodes
     if ((TERMINAL_FACE != i) && (face != i)) // that aren't the terminal or source face
-      facePrintf(i, "r%Z%z\n", R_ZPrinter, PKT_T);
+      enqueueR_PKT(i, PKT_T, PRIO_RELAY);
 
   return;
 }
@@ -353,575 +774,1869 @@ doaConvert(u32 d1, u32 d2)
 }
 
 /*
- * Summary:     Compiles the results of all the nodes if they are present.
- * Parameters:  None.
- * Return:      None.
+ * Summary:     Looks up a job in the job table.
+ * Parameters:  u32 job ID.
+ * Return:      The job, or 0 if it is not in the table.
  */
-void
-compileResults()
+struct JOB *
+findJob(u32 ID)
 {
-  if (HOST_CURRENT_DOA >= HOST_DOA) // if we've reached the goal degree of accuracy
-    return; // Don't bother compiling
+  if (NO_JOB == ID)
+    return 0;
 
-  if (0 == ROUND_NODE_ARR[0])
-    return; // Don't compile on a completed calculation
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if (ID == JOB_ARR[i].id)
+      return &JOB_ARR[i];
 
-  RESULT_COMPILED = 0; // reset the compiling slate
+  return 0;
+}
 
-  for (u32 i = 0; i < NODE_COUNT; ++i)
-    { // For every sequenced node
-      if ((SEQ_NODE_ARR[i] > 0) && (0 != RESULT_NODE_ARR[i])) // with a nonzero result
-        RESULT_COMPILED += RESULT_NODE_ARR[i]; // start compiling
-      else if ((SEQ_NODE_ARR[i] > 0) && (0 == RESULT_NODE_ARR[i]))
-        { // if a sequenced node has no result
-          RESULT_COMPILED = 0; // reset the compiled result
-          return; // and quit
-        }
+/*
+ * Summary:     Checks whether a job was recently dropped from the job table.
+ * Parameters:  u32 job ID.
+ * Return:      Boolean confirming the job's packets are stale.
+ */
+bool
+jobRetired(u32 ID)
+{
+  if (NO_JOB == ID)
+    return false;
+
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if (ID == RETIRED_JOB_ARR[i])
+      return true;
+
+  return false;
+}
+
+/*
+ * Summary:     Takes a slot in the job table for a new calculation.  A free slot
+ *              is used first, otherwise the job that finished longest ago is
+ *              retired to make room.  Jobs still short of their goal are never
+ *              displaced.
+ * Parameters:  u32 job ID, u32 DOA (whole), u32 DOA (decimal), u32 weight.
+ * Return:      The new job, or 0 if the job is in the table already or the
+ *              table is full of running jobs.
+ */
+struct JOB *
+startJob(u32 ID, u32 DOA1, u32 DOA2, u32 WEIGHT)
+{
+  struct JOB *J = 0;
+  u32 i;
+
+  if (findJob(ID))
+    {
+      logNormal("startJob:  Job %t is running already.\n", ID);
+      return 0;
     }
 
-  TOTAL_CIRCLE_COUNT += RESULT_COMPILED; // Keep track of every round
+  for (i = 0; (i < MAX_JOBS) && !J; ++i)
+    if (NO_JOB == JOB_ARR[i].id)
+      J = &JOB_ARR[i];
 
-  /* if all the sequenced nodes could be compiled
-   * calculate PI based off of the distributed computations */
-  CALC_PI = 4.0 * ((double) TOTAL_CIRCLE_COUNT / (ACTIVE_NODE_COUNT
-      * ROUND_NODE_ARR[0] * MAX_POINTS_GEN));
+  for (i = 0; (i < MAX_JOBS) && !J; ++i)
+    if (JOB_ARR[i].current_doa >= JOB_ARR[i].doa)
+      { // only finished jobs may be retired
+        for (u32 j = i + 1; j < MAX_JOBS; ++j)
+          if ((JOB_ARR[j].current_doa >= JOB_ARR[j].doa)
+              && ((JOB_ARR[j].run_time_start + JOB_ARR[j].run_time)
+                  < (JOB_ARR[i].run_time_start + JOB_ARR[i].run_time)))
+            i = j;
 
-  float previous_accuracy = HOST_CURRENT_DOA;
+        RETIRED_JOB_ARR[RETIRED_JOB_NEXT] = JOB_ARR[i].id; // keep its stragglers out
+        RETIRED_JOB_NEXT = (RETIRED_JOB_NEXT + 1) % MAX_JOBS;
+        J = &JOB_ARR[i];
+      }
 
-  HOST_CURRENT_DOA = 100.0 - (fabs(CALC_PI - PI) / PI * 100.0);
-  (HOST_CURRENT_DOA >= previous_accuracy) ? setStatus(GREEN) : setStatus(
-      RED); // and see how accurate the running total is
+  if (!J)
+    return 0;
 
-  if (HOST_CURRENT_DOA >= HOST_DOA)
-    { // if we've reached the goal degree of accuracy
-      setStatus(GREEN);
-      RUN_TIME = millis() - RUN_TIME_START; // record time taken to complete aggregation of results
+  J->id = NO_JOB; // so that it doesn't count towards the lowest pass
+  J->pass = INVALID;
 
-      return; // No flush necessary
-    }
+  for (i = 0; i < MAX_JOBS; ++i) // A newcomer starts level with the others
+    if ((NO_JOB != JOB_ARR[i].id) && ((INVALID == J->pass) || ((s32) (JOB_ARR[i].pass
+        - J->pass) < 0)))
+      J->pass = JOB_ARR[i].pass;
 
-  roundFlush(); // Spring cleaning
+  if (INVALID == J->pass)
+    J->pass = 0;
 
-  return;
+  calcFlush(J);
+
+  J->id = ID;
+  J->weight = ((0 == WEIGHT) ? 1 : ((WEIGHT > MAX_WEIGHT) ? MAX_WEIGHT : WEIGHT));
+  J->doa1 = DOA1; // Preserve the DOA pieces for forwarding
+  J->doa2 = DOA2;
+  J->doa = doaConvert(DOA1, DOA2); // Remember the new DOA
+
+  FOCUS_JOB = J - JOB_ARR; // Show the newest job on the table
+
+  return J;
 }
 
 /*
- * Summary:     Updates the table based on a recent result packet.
- * Parameters:  u32 index of the node that updated, u32 result of the node.
- * Return:      None.
+ * Summary:     Picks the job that gets the next point.  Jobs with room left in
+ *              their window of rounds take turns in proportion to their
+ *              weights (stride scheduling).
+ * Parameters:  None.
+ * Return:      The job to sample for, or 0 if none needs sampling.
  */
-void
-updateResult(u32 NODE_INDEX, u32 RESULT, u32 ROUND)
+struct JOB *
+nextJob()
 {
-  if ((NODE_INDEX < 0) || (NODE_INDEX > ARR_LENGTH - 1))
-    {
-      logNormal("updateResult:  Invalid node index %d\n", NODE_INDEX);
-      return;
-    }
+  struct JOB *NEXT = 0;
 
-  else if (RESULT < 0)
-    {
-      logNormal("updateResult:  Invalid result %d\n", RESULT);
-      return;
-    }
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if ((NO_JOB != JOB_ARR[i].id) && JOB_ARR[i].tx_flag && (!NEXT || ((s32) (JOB_ARR[i].pass
+        - NEXT->pass) < 0)))
+      NEXT = &JOB_ARR[i];
 
-  else if (ROUND < 0)
-    {
-      logNormal("updateResult:  Invalid round %d\n", ROUND);
-      return;
-    }
+  return NEXT;
+}
 
-  else if (0 == RESULT) // 0 is never a correct answer
-    return;
+/*
+ * Summary:     Issues the key for a packet originating here.  Keys are kept
+ *              strictly increasing so that packets sent within the same
+ *              millisecond aren't taken for duplicates.
+ * Parameters:  None.
+ * Return:      u32 packet key.
+ */
+u32
+packetStamp()
+{
+  u32 NOW = millis();
 
-  RESULT_NODE_ARR[NODE_INDEX] = RESULT; // record the node's result
-  ROUND_NODE_ARR[NODE_INDEX] = ROUND; // and its version
+  if ((s32) (NOW - NODE_ARR[0].stamp) <= 0)
+    NOW = NODE_ARR[0].stamp + 1;
 
-  return;
+  NODE_ARR[0].stamp = NOW;
+
+  return NOW;
 }
 
 /*
- * Summary:     Calculates PI through the following method:
- *
- *              Area of a Square, S = (2 * r)^2
- *              Area of a Circle, C = (PI * r^2)
- *              C / S = (PI * r^2) / (2 * r)^2 = PI / 4
- *              PI = 4 * C / S
- *
- *              Random points are used to approximate the geometric areas.
- * Parameters:  None.
+ * Summary:     Synthesizes a (r)esult packet carrying the host's result for a
+ *              round of a job, or a result of 0 if the host doesn't hold one
+ *              (which only announces the job).  Without a job, the packet only
+ *              announces the host.
+ * Parameters:  Job to report on or 0, u32 round, (r)esult packet to fill in.
  * Return:      None.
  */
 void
-calculate()
+hostR_PKT(struct JOB *J, u32 ROUND, struct R_PKT *PKT_T)
 {
-  if (!CALCULATE_TX_FLAG)
-    return;
+  PKT_T->key.ID = ID_NODE_ARR[0];
+  PKT_T->key.TIME = packetStamp();
 
-  if (POINTS_GEN >= MAX_POINTS_GEN)
+  if (!J)
     {
-      updateResult(0, HOST_RESULT, HOST_ROUND);
-
-      R_PKT PKT_T;
-
-      PKT_T.key.TIME = millis();
-
-      PKT_T.key.ID = ID_NODE_ARR[0];
-      PKT_T.doa1 = HOST_DOA_1;
-      PKT_T.doa2 = HOST_DOA_2;
-      PKT_T.doa_ver = HOST_DOA_VER;
-      PKT_T.result = RESULT_NODE_ARR[0]; // Always broadcasting last result
-      PKT_T.round = ROUND_NODE_ARR[0];
-
-      BRD_R_PKT(&PKT_T);
-
-      POINTS_GEN = 0;
-      HOST_RESULT = 0;
-      CALCULATE_TX_FLAG = false;
-
-      return; // Don't calculate if the point quota was met
+      PKT_T->job = NO_JOB;
+      PKT_T->weight = PKT_T->doa1 = PKT_T->doa2 = 0;
+      PKT_T->round = PKT_T->result = 0;
+      return;
     }
 
-  u32 x;
-  u32 y;
-  u32 hypotenuse;
-
-  // generate the random point
-  x = random(0, RADIUS + 1);
-  y = random(0, RADIUS + 1);
-  ++POINTS_GEN; // a point was generated within the square
-
-  hypotenuse = pow(x, 2) + pow(y, 2); // point distance from origin of the circle
-
-  if (hypotenuse <= pow(RADIUS, 2)) // if the point is within the radius
-    ++HOST_RESULT; // remember if it's a point within the circle
+  PKT_T->job = J->id;
+  PKT_T->weight = J->weight;
+  PKT_T->doa1 = J->doa1;
+  PKT_T->doa2 = J->doa2;
+  PKT_T->result = ownResult(J, ROUND);
+  PKT_T->round = ROUND;
 
   return;
 }
 
 /*
- * Summary:     Logs the ID and time-stamp keys of a received packet.
+ * Summary:     Broadcasts a packet of the host's own, if the host's allowance
+ *              has room for it.  What the host sends stays within what every
+ *              relay forwards for it, so none of it is dropped as spam.
+ * Parameters:  (r)esult packet.
+ * Return:      Boolean confirming the packet was sent.
+ */
+bool
+sendOwn(struct R_PKT *PKT_T)
+{
+  if (!bucketTake(&SEND_BUCKET, SEND_BUCKET_DEPTH, SEND_PERIOD))
+    return false; // It will go out again later if it is still needed
+
+  BRD_R_PKT(PKT_T);
+
+  return true;
+}
+
+/*
+ * Summary:     Broadcasts the host's results for a run of rounds of a job, as
+ *              far as it still holds them and its allowance goes.
+ * Parameters:  Job, u32 first round, u32 rounds.
+ * Return:      None.
+ */
+void
+resendRounds(struct JOB *J, u32 ROUND, u32 COUNT)
+{
+  R_PKT PKT_T;
+
+  for (u32 i = ROUND; i < ROUND + COUNT; ++i)
+    if (0 != ownResult(J, i))
+      {
+        hostR_PKT(J, i, &PKT_T);
+
+        if (!sendOwn(&PKT_T))
+          return; // The rest waits for the next heartbeat
+      }
+
+  return;
+}
+
+/*
+ * Summary:     Counts a time in its histogram bucket.
+ * Parameters:  Histogram, u32 time in milliseconds.
+ * Return:      None.
+ */
+void
+histAdd(struct HISTOGRAM *H, u32 TIME)
+{
+  u32 i = 0;
+
+  while ((i < HIST_BUCKETS - 1) && (TIME >= (HIST_BASE << i)))
+    ++i;
+
+  ++H->bucket[i];
+
+  if (TIME > H->max)
+    H->max = TIME;
+
+  return;
+}
+
+/*
+ * Summary:     Sends a telemetry record for a job's compiled round to the
+ *              terminal.  Records are delta-encoded against the job's previous
+ *              record, with absolute values every TELEMETRY_KEYFRAME records.
+ * Parameters:  Job that compiled a round.
+ * Return:      None.
+ */
+void
+telemetryRecord(struct JOB *J)
+{
+  if ((0 == TELEMETRY_MODE) || (0 != (J->round % TELEMETRY_RATE)))
+    return;
+
+  struct RECORD NOW; // this record's values
+  struct RECORD BASE =
+    { 0, 0, 0, 0, 0, 0 }; // values the record is relative to
+  char TYPE = 'K';
+  u32 STAMP = millis();
+
+  NOW.round = J->round;
+  NOW.pi = (s32) (J->calc_pi * 1e8 + 0.5);
+  NOW.accuracy = (s32) (J->current_doa * 1e4 + 0.5);
+  NOW.samples = J->total_points;
+  NOW.active = ACTIVE_NODE_COUNT;
+  NOW.time = ((0 == J->run_time) ? (STAMP - J->run_time_start) : J->run_time);
+
+  if (0 != (J->records % TELEMETRY_KEYFRAME))
+    {
+      TYPE = 'D';
+      BASE = J->last_record;
+    }
+
+  if ('c' == TELEMETRY_MODE)
+    facePrintf(TERMINAL_FACE, "%c,%t,%d,%d,%d,%d,%d,%d,%d", TYPE, J->id,
+        (s32) (NOW.round - BASE.round), NOW.pi - BASE.pi, NOW.accuracy
+            - BASE.accuracy, (s32) (NOW.samples - BASE.samples),
+        (s32) (NOW.active - BASE.active), (s32) (NOW.time - BASE.time),
+        J->node_count);
+  else
+    facePrintf(TERMINAL_FACE, "{\"t\":\"%c\",\"job\":\"%t\",\"round\":%d,"
+      "\"pi\":%d,\"acc\":%d,\"samples\":%d,\"active\":%d,\"time\":%d,"
+      "\"nodes\":[", TYPE, J->id, (s32) (NOW.round - BASE.round), NOW.pi
+        - BASE.pi, NOW.accuracy - BASE.accuracy, (s32) (NOW.samples
+        - BASE.samples), (s32) (NOW.active - BASE.active), (s32) (NOW.time
+        - BASE.time));
+
+  bool FIRST = true;
+
+  for (u32 i = 0; i < NODE_COUNT; ++i)
+    if (nodeIn(J->seq_set, i))
+      { // every node the job is sequenced on
+        u32 AGE = STAMP - heardTime(i);
+        u32 RESULT = J->share_arr[i].result; // the node's newest
+
+        if ('c' == TELEMETRY_MODE)
+          facePrintf(TERMINAL_FACE, ",%t,%d,%d", ID_NODE_ARR[i], RESULT,
+              AGE);
+        else
+          facePrintf(TERMINAL_FACE, "%s[\"%t\",%d,%d]", (FIRST ? "" : ","),
+              ID_NODE_ARR[i], RESULT, AGE);
+
+        FIRST = false;
+      }
+
+  facePrintf(TERMINAL_FACE, (('c' == TELEMETRY_MODE) ? "\n" : "]}\n"));
+
+  J->last_record = NOW;
+  ++J->records;
+
+  return;
+}
+
+/*
+ * Summary:     Adds a complete round to a job's estimate of PI.
+ * Parameters:  Job, double points within the circle from all the nodes, u32
+ *              results they came from.
+ * Return:      None.
+ */
+void
+compileRound(struct JOB *J, double RESULT_COMPILED, u32 RESULTS)
+{
+  J->total_circle_count += RESULT_COMPILED; // Keep track of every round
+  J->total_points += RESULTS * MAX_POINTS_GEN; // a node that went idle may have a result in
+  J->compiled = J->round;
+  histAdd(&ROUND_HIST, millis() - J->round_start);
+
+  /* if all the sequenced nodes could be compiled
+   * calculate PI based off of the distributed computations */
+  J->calc_pi = 4.0 * ((double) J->total_circle_count / J->total_points);
+
+  float previous_accuracy = J->current_doa;
+
+  J->current_doa = 100.0 - fabs(J->calc_pi - PI) * PI_PERCENT;
+  telemetryRecord(J);
+  (J->current_doa >= previous_accuracy) ? setStatus(GREEN) : setStatus(RED); // and see how accurate the running total is
+
+  if (J->current_doa >= J->doa)
+    { // if we've reached the goal degree of accuracy
+      setStatus(GREEN);
+      J->run_time = millis() - J->run_time_start; // record time taken to complete aggregation of results
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Compiles the oldest round of a job if the results of all the
+ *              nodes are present, and every round after it that is complete
+ *              as well.  Once the goal is reached the estimate stands, but
+ *              complete rounds still move the job on, since the other boards
+ *              may need the host's results for rounds to come.
+ * Parameters:  Job to compile.
+ * Return:      None.
+ */
+void
+compileResults(struct JOB *J)
+{
+  PROFILE(PROBE_COMPILE_RESULTS);
+
+  for (;;)
+    {
+      u32 *HELD = J->held_set[J->round % ROUND_SLOTS];
+
+      for (u32 i = 0; i < NODE_WORDS; ++i) // For every word of sequenced nodes
+        if (J->seq_set[i] & ~HELD[i])
+          return; // if a sequenced node has no result for the round, quit
+
+      if (J->current_doa < J->doa) // until we've reached the goal degree of accuracy
+        compileRound(J, J->sum_arr[J->round % ROUND_SLOTS],
+            J->count_arr[J->round % ROUND_SLOTS]); // the results were summed as they came in
+
+      roundFlush(J); // Spring cleaning
+    }
+}
+
+/*
+ * Summary:     Updates the table based on a recent result packet and compiles
+ *              the rounds it completes.  Results for rounds already compiled,
+ *              or too far ahead to hold, are passed over.
+ * Parameters:  Job the result belongs to, u32 index of the node that updated,
+ *              u32 result of the node, u32 round of the result.
+ * Return:      None.
+ */
+void
+updateResult(struct JOB *J, u32 NODE_INDEX, u32 RESULT, u32 ROUND)
+{
+  if ((NODE_INDEX < 0) || (NODE_INDEX > ARR_LENGTH - 1))
+    {
+      logNormal("updateResult:  Invalid node index %d\n", NODE_INDEX);
+      return;
+    }
+
+  else if (RESULT < 0)
+    {
+      logNormal("updateResult:  Invalid result %d\n", RESULT);
+      return;
+    }
+
+  else if (ROUND < 0)
+    {
+      logNormal("updateResult:  Invalid round %d\n", ROUND);
+      return;
+    }
+
+  else if (0 == RESULT) // 0 is never a correct answer
+    return;
+
+  else if ((0 != NODE_INDEX) && ((ROUND < J->round) || (ROUND - J->round
+      >= ROUND_SLOTS)))
+    return; // The host's own results always fit, as it samples within its window
+
+  u32 SLOT = ROUND % ROUND_SLOTS;
+  struct SHARE *SHARE = &J->share_arr[NODE_INDEX];
+
+  if (0 == NODE_INDEX)
+    { // kept apart, as the host may need to send it again
+      J->own_arr[SLOT] = RESULT;
+      J->own_round_arr[SLOT] = ROUND;
+    }
+
+  if (heldResult(J, NODE_INDEX, ROUND))
+    return; // Counted already
+
+  if ((0 != NODE_INDEX) && (ROUND == J->round)) // first result this round
+    histAdd(&LATENCY_HIST, millis() - J->round_start);
+
+  nodeMark(J->held_set[SLOT], NODE_INDEX, true); // record that the node's result is in
+
+  if (nodeIn(J->seq_set, NODE_INDEX)) // Only the sequenced nodes make up the round
+    {
+      J->sum_arr[SLOT] += RESULT;
+      ++J->count_arr[SLOT];
+    }
+
+  if (ROUND > shareRound(J, NODE_INDEX)) // Rounds start at 1, so an empty share is always older
+    { // and show the node's newest
+      SHARE->round = ROUND;
+      SHARE->result = RESULT;
+    }
+
+  compileResults(J); // A round is compiled as soon as it is complete
+
+  if (roundWanted(J)) // A finished job may be wanted for the round again
+    J->tx_flag = true;
+
+  return;
+}
+
+/*
+ * Summary:     Generates points with xorshift32 on the lanes in turn and counts
+ *              those within the radius.  The top and bottom halves of each
+ *              random word are scaled to 0..RADIUS for x and y.
+ * Parameters:  u32 lane states, u32 points to generate.
+ * Return:      u32 points inside the circle.
+ */
+u32
+samplePoints(u32 *LANE_ARR, u32 COUNT)
+{
+  u32 INSIDE = 0;
+
+  for (u32 i = 0; i < COUNT; ++i)
+    {
+      u32 *STATE = &LANE_ARR[i % SAMPLE_LANES];
+
+      *STATE ^= *STATE << 13;
+      *STATE ^= *STATE >> 17;
+      *STATE ^= *STATE << 5;
+
+      u32 x = COORD<RADIUS + 1>::scale(*STATE >> 16);
+      u32 y = COORD<RADIUS + 1>::scale(*STATE & 0xffff);
+
+      if (x * x + y * y <= RADIUS_SQUARED) // if the point is within the radius
+        ++INSIDE;
+    }
+
+  return INSIDE;
+}
+
+/*
+ * Summary:     Calculates PI through the following method:
+ *
+ *              Area of a Square, S = (2 * r)^2
+ *              Area of a Circle, C = (PI * r^2)
+ *              C / S = (PI * r^2) / (2 * r)^2 = PI / 4
+ *              PI = 4 * C / S
+ *
+ *              Random points are used to approximate the geometric areas.
+ *              Each call generates up to SAMPLE_BATCH points for whichever job
+ *              is next in line.  A job's rounds are sampled one after another
+ *              while the earlier ones are still being gathered, up to
+ *              ROUND_WINDOW rounds ahead of the oldest one not yet compiled.
+ * Parameters:  None.
+ * Return:      Boolean confirming a job still wanted sampling.
+ */
+bool
+calculate()
+{
+  PROFILE(PROBE_CALCULATE);
+
+  struct JOB *J = nextJob();
+
+  if (!J)
+    return false; // Every job has filled its window of rounds
+
+  if (0 == J->points_gen)
+    { // A round's result is paid for as the round starts
+      if (bucketLevel(&SEND_BUCKET, SEND_BUCKET_DEPTH, SEND_PERIOD)
+          <= SEND_RESERVE)
+        return false; // Starting another round now would leave nothing for resends
+
+      --SEND_BUCKET.tokens;
+    }
+
+  if (J->points_gen >= MAX_POINTS_GEN)
+    {
+      R_PKT PKT_T;
+
+      updateResult(J, 0, J->result, J->sample_round);
+      hostR_PKT(J, J->sample_round, &PKT_T);
+      BRD_R_PKT(&PKT_T); // paid for already
+
+      J->points_gen = 0;
+      J->result = 0;
+      ++J->sample_round; // Go on with the next round while this one is gathered
+      J->tx_flag = roundWanted(J); // if it is wanted
+
+      return true; // Don't calculate if the point quota was met
+    }
+
+  u32 COUNT = MAX_POINTS_GEN - J->points_gen;
+
+  if (COUNT > SAMPLE_BATCH)
+    COUNT = SAMPLE_BATCH;
+
+  J->result += SAMPLE_KERNEL(SAMPLE_LANE_ARR, COUNT); // remember the points within the circle
+  J->points_gen += COUNT; // points generated within the square
+  J->pass += COUNT * (JOB_STRIDE / J->weight); // heavier jobs come around sooner
+
+  return true;
+}
+
+/*
+ * Summary:     Folds a new sample into a smoothed mean and deviation, the same
+ *              way TCP smooths its round-trip time (gains of 1/8 and 1/4).
+ * Parameters:  u32 mean (scaled by 8), u32 deviation (scaled by 4), u32 sample.
+ * Return:      None.
+ */
+void
+smoothSample(u32 *MEAN, u32 *DEV, u32 SAMPLE)
+{
+  if (0 == *MEAN)
+    { // First sample seeds the estimate
+      *MEAN = SAMPLE << 3;
+      *DEV = SAMPLE << 1;
+      return;
+    }
+
+  s32 ERR = (s32) SAMPLE - (s32) (*MEAN >> 3);
+
+  *MEAN += ERR;
+
+  if (ERR < 0)
+    ERR = -ERR;
+
+  *DEV += ERR - (s32) (*DEV >> 2);
+
+  return;
+}
+
+/*
+ * Summary:     Works out how long a node may stay silent before it is idle,
+ *              from the spacing of its packets and the delay of its face.  A
+ *              neighbor is sure to ping every pingFaces_PERIOD; beyond the
+ *              neighbors, only heartbeats are sure to come.
+ * Parameters:  u32 index of the node.
+ * Return:      Silence limit in milliseconds, between the node's floor and
+ *              IDLE.
+ */
+u32
+idleLimit(u32 NODE_INDEX)
+{
+  struct NODE *N = &NODE_ARR[NODE_INDEX];
+
+  if (N->gaps < IDLE_WARMUP)
+    return IDLE; // Not enough measured yet
+
+  u32 FACE = N->face;
+  u32 LIMIT = (N->gap >> 3) + IDLE_DEV_FACTOR * (N->gap_dev >> 2)
+      + (RTT_FACE_ARR[FACE] >> 3)
+      + IDLE_DEV_FACTOR * (RTT_DEV_FACE_ARR[FACE] >> 2);
+  u32 FLOOR = (N->neighbor ? ((RTT_FACE_ARR[FACE] >> 3) + IDLE_PINGS
+      * pingFaces_PERIOD) : IDLE_MIN);
+
+  if (LIMIT < FLOOR)
+    return FLOOR;
+
+  if (LIMIT > IDLE)
+    return IDLE;
+
+  return LIMIT;
+}
+
+/*
+ * Summary:     Notes that a node was just heard from and learns how often it
+ *              is heard from.  A node returning from idle starts over.
+ * Parameters:  u32 index of the node.
+ * Return:      None.
+ */
+void
+heardFrom(u32 NODE_INDEX)
+{
+  struct NODE *N = &NODE_ARR[NODE_INDEX];
+
+  if (nodeIn(ACTIVE_NODE_SET, NODE_INDEX))
+    {
+      u32 GAP = N->gap;
+      u32 GAP_DEV = N->gap_dev;
+      u32 SPACING = millis() - heardTime(NODE_INDEX);
+
+      if (SPACING > IDLE + pingAll_PERIOD) // An active node is never silent for longer
+        SPACING = IDLE + pingAll_PERIOD; // and this keeps the smoothed values in 16 bits
+
+      smoothSample(&GAP, &GAP_DEV, SPACING);
+      N->gap = GAP;
+      N->gap_dev = GAP_DEV;
+
+      if (N->gaps < IDLE_WARMUP)
+        ++N->gaps;
+    }
+
+  else
+    {
+      N->gap = N->gap_dev = 0;
+      N->gaps = 0;
+    }
+
+  heardNow(NODE_INDEX);
+
+  return;
+}
+
+/*
+ * Summary:     Logs the ID and time-stamp keys of a received packet.
  * Parameters:  u32 ID, u32 time-stamp (from a (r)esult packet)
  * Return:      Return index of the node if successful, otherwise INVALID.
  */
 u32
 log(u32 ID, u32 TIME)
 {
-  if (TIME < 0)
-    {
-      logNormal("log:  No time-traveling or overflow allowed!\n");
-      API_ASSERT_GREATER_EQUAL(TIME, 0); // blinkcode!
-    }
+  PROFILE(PROBE_LOG);
+
+  if (TIME < 0)
+    {
+      logNormal("log:  No time-traveling or overflow allowed!\n");
+      API_ASSERT_GREATER_EQUAL(TIME, 0); // blinkcode!
+    }
+
+  for (u32 i = 0; i < NODE_COUNT; ++i)
+    { // Look for an existing match in the list of previous PING'ers
+      if (ID == ID_NODE_ARR[i])
+        {
+          ++NODE_ARR[i].count.rx;
+
+          if ((s32) (TIME - NODE_ARR[i].stamp) > 0)
+            { // If there is a match and it is a new packet
+              if (NODE_ARR[i].pings < 0xffff) // Make sure ping count won't overflow
+                ++NODE_ARR[i].pings; // So we can keep track of the valid packet
+              else
+                // Notify us if the ping count will overflow
+                logNormal("Limit of pings reached for IXM %t\n", ID);
+
+              NODE_ARR[i].stamp = TIME; // Update nodular time-stamp
+              heardFrom(i); // Update host-based time-stamp
+
+              return i; // Return the location of the existing node
+            }
+
+          else if (!nodeIn(ACTIVE_NODE_SET, i) && ((s32) (NODE_ARR[i].stamp
+              - TIME) > (s32) IDLE))
+            { // An idle IXM whose clock went back that far has rebooted
+              NODE_ARR[i].pings = 1;
+              NODE_ARR[i].stamp = TIME; // so its keys start over
+              heardFrom(i);
+
+              return i;
+            }
+
+          else
+            { // Don't forward the packet if it isn't newer than the last one
+              ++NODE_ARR[i].count.dup;
+              return INVALID;
+            }
+        }
+    }
+
+  // Otherwise check to see if there is any free space left in the array
+  if (NODE_COUNT >= (sizeof(NODE_ARR) / sizeof(NODE_ARR[0])))
+    {
+      logNormal("Inadequate memory space in ID table.\n"
+        "Rebooting.\n");
+      reenterBootloader(); // Clear out memory for new boards
+    }
+
+  // Add the new IXM board to the phone-book.
+  struct NODE *N = &NODE_ARR[NODE_COUNT];
+
+  ID_NODE_ARR[NODE_COUNT] = ID;
+  N->stamp = TIME;
+  heardNow(NODE_COUNT);
+  ++N->pings;
+  ++N->count.rx;
+  bucketFill(&N->bucket, ORIGIN_BUCKET_DEPTH); // Newcomers start with a full allowance
+
+  return NODE_COUNT++; // And pass it on
+}
+
+/*
+ * Summary:     Checks a (r)esult packet that is no newer than the last one from
+ *              its IXM for a result the host is still missing.  An IXM sends
+ *              its rounds in order, but the copies take different ways here,
+ *              so an earlier round can arrive after a later one.
+ * Parameters:  (r)esult packet.
+ * Return:      u32 index of the node the result is missing for, INVALID if it
+ *              isn't needed.
+ */
+u32
+lateResult(struct R_PKT *PKT_R)
+{
+  struct JOB *J = findJob(PKT_R->job);
+
+  if (!J || (0 == PKT_R->result) || (PKT_R->round < J->round)
+      || (PKT_R->round - J->round >= ROUND_SLOTS))
+    return INVALID; // Not a result the host is gathering
+
+  for (u32 i = 1; i < NODE_COUNT; ++i)
+    if (ID_NODE_ARR[i] == PKT_R->key.ID)
+      return (heldResult(J, i, PKT_R->round) ? INVALID : i);
+
+  return INVALID;
+}
+
+/*
+ * Summary:     Resends the host's results for a round that another board is
+ *              still gathering after the host compiled it, and for the rest of
+ *              that board's window, in case that board lost them.  Answers go
+ *              out at most once a heartbeat, as the answers of the other boards
+ *              that are further along look just the same.
+ * Parameters:  Job, u32 round.
+ * Return:      None.
+ */
+void
+answerRound(struct JOB *J, u32 ROUND)
+{
+  u32 NOW = millis();
+
+  if (NOW - J->answer_time < pingAll_PERIOD)
+    return; // Answered already
+
+  resendRounds(J, ROUND, ROUND_WINDOW);
+
+  J->answer_time = NOW;
+
+  return;
+}
+
+/*
+ * Summary:     Accepts a received (r)esult.  Packet information is logged and
+ *              result is logged for the specific calculation.
+ * Parameters:  (r)esult packet, u8 face it was received on.
+ * Return:      None.
+ */
+void
+acceptR_PKT(struct R_PKT *PKT_R, u8 face)
+{
+  struct COUNTERS *FACE_COUNT = &FACE_COUNT_ARR[face & 3];
+  u32 NODE_INDEX; // index holder for if log is valid
+
+  TRACE_EVENT('r', face, PKT_R);
+
+  ++FACE_COUNT->rx;
+
+  // only log properly formatted packets
+  if (INVALID == (NODE_INDEX = log(PKT_R->key.ID, PKT_R->key.TIME)))
+    {
+      if (INVALID == (NODE_INDEX = lateResult(PKT_R)))
+        {
+          ++FACE_COUNT->dup;
+          return; // Don't continue if this packet has been received before
+        }
+
+      --NODE_ARR[NODE_INDEX].count.dup; // It was overtaken, not repeated
+    }
+
+  struct NODE *N = &NODE_ARR[NODE_INDEX];
+
+  N->face = face; // Remember the way to this node
+
+  if (!bucketTake(&N->bucket, ORIGIN_BUCKET_DEPTH,
+      ORIGIN_REFILL_PERIOD))
+    { // Don't continue if this IXM is spamming packets right now
+      ++FACE_COUNT->spam;
+      ++N->count.spam;
+      return;
+    }
+
+  else if (jobRetired(PKT_R->job))
+    { // Don't continue if this is an old calculation, but it's expected at times
+      ++FACE_COUNT->stale;
+      ++N->count.stale;
+      return;
+    }
+
+  // If all the hoops have been jumped through
+  FWD_R_PKT(PKT_R, face); // Forward the packet
+  ++FACE_COUNT->fwd;
+  ++N->count.fwd;
+
+  if (NO_JOB == PKT_R->job) // If an IXM has nothing to calculate
+    return; // it was only letting us know it's there
+
+  if (0 == PKT_R->round) // If an IXM was hot-swapped in during a calculation
+    return; // It should not continue
+
+  struct JOB *J = findJob(PKT_R->job);
+
+  if (!J)
+    { //If this is a new calculation
+      if (PKT_R->round > ROUND_WINDOW + 1) // If an IXM was hot-swapped in
+        return; // It should ignore the calculation
+
+      if (!(J = startJob(PKT_R->job, PKT_R->doa1, PKT_R->doa2, PKT_R->weight)))
+        {
+          logNormal("acceptR_PKT:  No room for job %t.\n", PKT_R->job);
+          return; // Someone else will have to do it
+        }
+    }
+
+  u32 ROUND = J->round; // compiled up to here before this packet
+
+  updateResult(J, NODE_INDEX, PKT_R->result, PKT_R->round); // and update
+
+  if (PKT_R->round < ROUND) // If the IXM is still gathering a round compiled here
+    answerRound(J, PKT_R->round); // help it along
+
+  return;
+}
+
+/*
+ * Summary:     Handles (r)esult packet reflex.
+ * Parameters:  (r)esult packet.
+ * Return:      None.
+ */
+void
+r_handler(u8 * packet)
+{
+  PROFILE(PROBE_R_HANDLER);
+
+  R_PKT PKT_R;
+
+  if (packetScanf(packet, "%Zr%z\n", R_ZScanner, &PKT_R) != 3)
+    {
+      logNormal("r_handler:  Failed at %d\n", packetCursor(packet));
+      ++FACE_COUNT_ARR[packetSource(packet) & 3].bad;
+      return; // Filter out bad packets
+    }
+
+  acceptR_PKT(&PKT_R, packetSource(packet));
+
+  return;
+}
+
+/*
+ * Summary:     Handles (b)atch packet reflex.  Each of the ';'-separated
+ *              results is accepted as though it came in its own (r)esult
+ *              packet.
+ * Parameters:  (b)atch packet.
+ * Return:      None.
+ */
+void
+b_handler(u8 * packet)
+{
+  PROFILE(PROBE_B_HANDLER);
+
+  R_PKT PKT_R;
+  u32 MATCHED;
+
+  if (packetScanf(packet, "%Zb%z", R_ZScanner, &PKT_R) != 2)
+    {
+      logNormal("b_handler:  Failed at %d\n", packetCursor(packet));
+      ++FACE_COUNT_ARR[packetSource(packet) & 3].bad;
+      return; // Filter out bad packets
+    }
+
+  acceptR_PKT(&PKT_R, packetSource(packet));
+
+  while ((MATCHED = packetScanf(packet, "%Z;%z", R_ZScanner, &PKT_R)) == 2)
+    acceptR_PKT(&PKT_R, packetSource(packet));
+
+  if ((0 != MATCHED) || (packetScanf(packet, "\n") != 1))
+    { // The records before the damage were fine on their own
+      logNormal("b_handler:  Failed at %d\n", packetCursor(packet));
+      ++FACE_COUNT_ARR[packetSource(packet) & 3].bad;
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Handles (d)istribute packet reflex.  A new job is started and
+ *              announced in a R packet forwarded to neighboring nodes.
+ * Parameters:  (d)istribute packet.
+ * Return:      None.
+ */
+void
+d_handler(u8 * packet)
+{
+  PROFILE(PROBE_D_HANDLER);
+
+  D_PKT PKT_R;
+
+  if (packetScanf(packet, "%Zd%z\n", D_ZScanner, &PKT_R) != 3)
+    {
+      logNormal("Failed at %d\n", packetCursor(packet));
+      ++FACE_COUNT_ARR[packetSource(packet) & 3].bad;
+      return;
+    }
+
+#ifdef SYNERGY_TRACE
+  R_PKT PKT_D; // the request as the trace keeps it
+
+  memset(&PKT_D, 0, sizeof(PKT_D));
+  PKT_D.doa1 = PKT_R.doa1;
+  PKT_D.doa2 = PKT_R.doa2;
+  PKT_D.weight = PKT_R.weight;
+  TRACE_EVENT('d', packetSource(packet), &PKT_D);
+#endif
+
+  float DOA = doaConvert(PKT_R.doa1, PKT_R.doa2);
+
+  if (DOA < 0.0)
+    {
+      logNormal("d_handler:  Input %f must be a non-negative integer.\n", DOA);
+      return;
+    }
+
+  if (DOA > DOA_THRESHOLD)
+    {
+      logNormal(
+          "d_handler:  Degree of accuracy %f must be less than the threshold %f.\n",
+          DOA, DOA_THRESHOLD);
+      return;
+    }
+
+  if ((0 == PKT_R.weight) || (PKT_R.weight > MAX_WEIGHT))
+    {
+      logNormal("d_handler:  Weight %d must be between 1 and %d.\n",
+          PKT_R.weight, MAX_WEIGHT);
+      return;
+    }
+
+  u32 ID; // job ID's are the issuing IXM's whole ID spread out plus a serial number
+
+  do
+    ID = ID_NODE_ARR[0] * JOB_ID_SPREAD + ++JOB_SERIAL;
+  while ((NO_JOB == ID) || findJob(ID) || jobRetired(ID));
+
+  struct JOB *J = startJob(ID, PKT_R.doa1, PKT_R.doa2, PKT_R.weight);
+
+  if (!J)
+    {
+      logNormal("d_handler:  All %d jobs are still running.\n", MAX_JOBS);
+      return;
+    }
+
+  R_PKT PKT_T;
+
+  // Relevant R packet info, without a result yet
+  hostR_PKT(J, J->round, &PKT_T);
+
+  // If all the hoops have been jumped through and the allowance has room
+  if (bucketTake(&SEND_BUCKET, SEND_BUCKET_DEPTH, SEND_PERIOD)) // (otherwise the first round tells)
+    FWD_R_PKT(&PKT_T, packetSource(packet)); // Forward the result packet
+
+  return;
+}
+
+/*
+ * Summary:     Appends text to the table line being rendered.
+ * Parameters:  u32 write position, text.
+ * Return:      None.
+ */
+void
+fmtText(u32 *POS, const char *TEXT)
+{
+  while (*TEXT && (*POS < TABLE_WIDTH))
+    TABLE_BUF[(*POS)++] = *TEXT++;
+
+  return;
+}
+
+/*
+ * Summary:     Pads the table line being rendered up to a column.
+ * Parameters:  u32 write position, u32 column, char fill.
+ * Return:      None.
+ */
+void
+fmtPad(u32 *POS, u32 COLUMN, char FILL)
+{
+  while ((*POS < COLUMN) && (*POS < TABLE_WIDTH))
+    TABLE_BUF[(*POS)++] = FILL;
+
+  return;
+}
+
+/*
+ * Summary:     Appends a number right-aligned in a field of the table line
+ *              being rendered.
+ * Parameters:  u32 write position, u32 value, u32 base (10 or 36), u32 field
+ *              width, char fill.
+ * Return:      None.
+ */
+void
+fmtNum(u32 *POS, u32 VALUE, u32 BASE, u32 WIDTH, char FILL)
+{
+  char DIGITS[12]; // enough for any u32 in base 10 or 36
+  u32 n = 0;
+
+  do
+    {
+      u32 d = VALUE % BASE;
+      DIGITS[n++] = ((d < 10) ? ('0' + d) : ('A' + d - 10));
+      VALUE /= BASE;
+    }
+  while (VALUE);
+
+  fmtPad(POS, *POS + ((WIDTH > n) ? (WIDTH - n) : 0), FILL);
+
+  while (n && (*POS < TABLE_WIDTH))
+    TABLE_BUF[(*POS)++] = DIGITS[--n];
+
+  return;
+}
+
+/*
+ * Summary:     Appends a fixed-point number to the table line being rendered.
+ *              The value is rounded to an integer once and its digits are
+ *              peeled off with integer arithmetic.
+ * Parameters:  u32 write position, double value, u32 decimals, u32 field width.
+ * Return:      None.
+ */
+void
+fmtFixed(u32 *POS, double VALUE, u32 DECIMALS, u32 WIDTH)
+{
+  u64 SCALE = POW10_ARR[DECIMALS];
+  u64 FIXED = ((VALUE > 0.0) ? (u64) (VALUE * SCALE + 0.5) : 0); // nearest
+
+  fmtNum(POS, (u32) (FIXED / SCALE), 10, ((WIDTH > DECIMALS + 1) ? (WIDTH
+      - DECIMALS - 1) : 0), ' ');
+
+  if (0 == DECIMALS)
+    return;
+
+  fmtText(POS, ".");
+
+  for (FIXED %= SCALE, SCALE /= 10; SCALE && (*POS < TABLE_WIDTH); SCALE /= 10)
+    {
+      TABLE_BUF[(*POS)++] = '0' + (char) (FIXED / SCALE);
+      FIXED %= SCALE;
+    }
+
+  return;
+}
+
+/*
+ * Summary:     Renders one line of the table into TABLE_BUF.
+ * Parameters:  u32 line number, job on display or 0.
+ * Return:      Boolean confirming the line exists; false past the bottom.
+ */
+bool
+tableRender(u32 LINE, struct JOB *J)
+{
+  u32 POS = 0;
+  u32 JOBS = 0; // jobs in the table
+
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if (NO_JOB != JOB_ARR[i].id)
+      ++JOBS;
+
+  if ((0 == LINE) || (LINE == 12 + NODE_COUNT + JOBS))
+    { // top and bottom border
+      fmtText(&POS, "+");
+      fmtPad(&POS, TABLE_WIDTH - 1, '=');
+      fmtText(&POS, "+");
+    }
+
+  else if ((2 == LINE) || (LINE == 5 + NODE_COUNT) || (LINE == 9 + NODE_COUNT))
+    { // section rules
+      fmtText(&POS, "+");
+      fmtPad(&POS, TABLE_WIDTH - 1, '-');
+      fmtText(&POS, "+");
+    }
+
+  else if (1 == LINE)
+    { // DOA = degree of accuracy
+      fmtText(&POS, "|DOA: ");
+
+      if (J)
+        {
+          fmtFixed(&POS, J->doa, 4, 0);
+          fmtText(&POS, "%");
+        }
+      else
+        fmtText(&POS, "--");
+
+      fmtPad(&POS, 31, ' ');
+      fmtText(&POS, "HOST TIME: ");
+      fmtNum(&POS, TABLE_TIME, 10, 10, '0');
+    }
+
+  else if (3 == LINE)
+    fmtText(&POS,
+        "|ID       ACTIVE     TIME-STAMP     SEQ      PINGS     ROUND     RESULT");
+
+  else if (4 == LINE)
+    fmtText(&POS,
+        "+----     ------     ----------     ----     -----     -----     ------+");
+
+  else if (LINE < 5 + NODE_COUNT)
+    {
+      u32 i = LINE - 5;
+
+      fmtText(&POS, "|");
+      fmtNum(&POS, ID_NODE_ARR[i], 36, 4, '0');
+      fmtPad(&POS, 15, ' ');
+      TABLE_BUF[POS++] = (nodeIn(ACTIVE_NODE_SET, i) ? 'A' : 'I');
+      fmtNum(&POS, heardTime(i), 10, 15, ' ');
+      fmtNum(&POS, sequenceOrder((J ? J->seq_set : ACTIVE_NODE_SET), i), 10,
+          9, ' ');
+      fmtNum(&POS, NODE_ARR[i].pings, 10, 10, ' ');
+      fmtNum(&POS, (J ? shareRound(J, i) : 0), 10, 10, ' '); // the node's newest result
+      fmtNum(&POS, (J ? J->share_arr[i].result : 0), 10, 11, ' ');
+    }
+
+  else if (LINE == 6 + NODE_COUNT)
+    {
+      fmtText(&POS, "|PI ESTIMATE: ");
+
+      if (J)
+        fmtFixed(&POS, J->calc_pi, PRECISION, 0);
+      else
+        fmtText(&POS, "--");
+
+      fmtPad(&POS, 31, ' ');
+      fmtText(&POS, "RUN TIME: ");
+
+      if (J)
+        fmtNum(&POS, ((0 == J->run_time) ? (millis() - J->run_time_start)
+            : J->run_time), 10, 10, '0');
+      else
+        fmtText(&POS, "--");
+    }
+
+  else if (LINE == 7 + NODE_COUNT)
+    {
+      fmtText(&POS, "|PI ACTUAL:   ");
+      fmtFixed(&POS, PI, PRECISION, 0);
+      fmtPad(&POS, 31, ' ');
+      fmtText(&POS, "POINTS GENERATED: ");
+      fmtNum(&POS, (J ? J->total_points : 0), 10, 10, ' ');
+    }
+
+  else if (LINE == 8 + NODE_COUNT)
+    {
+      fmtText(&POS, "|");
+      fmtPad(&POS, 31, ' ');
+      fmtText(&POS, "ACCURACY ACHIEVED: ");
+      fmtFixed(&POS, (J ? J->current_doa : 0.0), 4, 0);
+      fmtText(&POS, "%");
+    }
+
+  else if (LINE == 10 + NODE_COUNT)
+    fmtText(&POS, "|JOB         WEIGHT     ROUND         GOAL      ACHIEVED");
+
+  else if (LINE == 11 + NODE_COUNT)
+    fmtText(&POS, "|----        ------     -----         ----      --------");
+
+  else if (LINE < 12 + NODE_COUNT + JOBS)
+    {
+      u32 n = LINE - 12 - NODE_COUNT; // n-th job in the table
+      u32 i = 0;
+
+      for (; (i < MAX_JOBS) && ((NO_JOB == JOB_ARR[i].id) || n--); ++i)
+        ;
+
+      fmtText(&POS, "|");
+      fmtNum(&POS, JOB_ARR[i].id, 36, 8, '0');
+      fmtNum(&POS, JOB_ARR[i].weight, 10, 10, ' ');
+      fmtNum(&POS, JOB_ARR[i].round, 10, 10, ' ');
+      fmtFixed(&POS, JOB_ARR[i].doa, 4, 12);
+      fmtText(&POS, "%");
+      fmtFixed(&POS, JOB_ARR[i].current_doa, 4, 13);
+      fmtText(&POS, "%");
+    }
+
+  else
+    return false; // Past the bottom
+
+  if ('|' == TABLE_BUF[0])
+    { // close off text lines
+      fmtPad(&POS, TABLE_WIDTH - 1, ' ');
+      TABLE_BUF[POS++] = '|';
+    }
+
+  TABLE_BUF[POS] = 0;
+
+  return true;
+}
+
+/*
+ * Summary:     Hashes a rendered table line (32-bit FNV-1a).
+ * Parameters:  None.
+ * Return:      u32 hash of TABLE_BUF.
+ */
+u32
+tableHash()
+{
+  u32 HASH = 2166136261u;
+
+  for (u32 i = 0; TABLE_BUF[i]; ++i)
+    HASH = (HASH ^ (u8) TABLE_BUF[i]) * 16777619u;
+
+  return HASH;
+}
+
+/*
+ * Summary:     Renders the next line of the table and sends it to the terminal
+ *              only if it differs from what the terminal shows.  Lines are put
+ *              in place with cursor addressing, so a refresh is spread over as
+ *              many loops as it takes and costs link time only for changes.
+ * Parameters:  None.
+ * Return:      Boolean confirming lines are left to render.
+ */
+bool
+tableStep()
+{
+  if (INVALID == TABLE_LINE)
+    return false; // Nothing to print
+
+  PROFILE(PROBE_TABLE_STEP);
+
+  if ((0 == TABLE_LINE) && TABLE_CLEAR)
+    { // Start from a blank screen
+      facePrintf(TERMINAL_FACE, "\x1b[2J");
+
+      for (u32 i = 0; i < TABLE_LINES; ++i)
+        TABLE_HASH[i] = 0;
+
+      TABLE_SHOWN = 0;
+      TABLE_CLEAR = false;
+    }
+
+  struct JOB *J = ((NO_JOB != JOB_ARR[FOCUS_JOB].id) ? &JOB_ARR[FOCUS_JOB] : 0); // job on display
+
+  if ((TABLE_LINE >= TABLE_LINES) || !tableRender(TABLE_LINE, J))
+    { // Wipe whatever the last refresh left below the bottom
+      for (u32 i = TABLE_LINE; i < TABLE_SHOWN; ++i)
+        {
+          facePrintf(TERMINAL_FACE, "\x1b[%d;1H\x1b[K", i + 1);
+          TABLE_HASH[i] = 0;
+        }
+
+      TABLE_SHOWN = TABLE_LINE;
+      TABLE_LINE = INVALID; // That's all, until the next refresh
+
+      return false;
+    }
+
+  u32 HASH = tableHash();
+
+  if (HASH != TABLE_HASH[TABLE_LINE])
+    {
+      facePrintf(TERMINAL_FACE, "\x1b[%d;1H%s\n", TABLE_LINE + 1, TABLE_BUF);
+      TABLE_HASH[TABLE_LINE] = HASH;
+    }
+
+  ++TABLE_LINE;
+
+  return true;
+}
+
+/*
+ * Summary:     Starts a table refresh on interval.  A refresh that is still
+ *              being printed is left to finish rather than restarted.
+ * Parameters:  Time when function was called, handled automatically
+ * Return:  None
+ */
+void
+printTable(u32 when)
+{
+  PROFILE(PROBE_PRINT_TABLE);
+
+  if (when < 0)
+    {
+      logNormal("log:  No time-traveling or overflow allowed!\n");
+      API_ASSERT_GREATER_EQUAL(when, 0); // blinkcode!
+    }
+
+  if ((INVALID == TABLE_LINE) && (0 == TELEMETRY_MODE)) // the stream has the terminal to itself
+    {
+      TABLE_LINE = 0;
+      TABLE_TIME = when;
+    }
+
+  Alarms.set(Alarms.currentAlarmNumber(), when + printTable_PERIOD); // schedule the next table printout
+
+  return;
+}
+
+/*
+ * Summary:     Sets a table-printing alarm that will reset itself on interval.
+ * Parameters:  (t)able packet.
+ * Return:      None.
+ */
+void
+t_handler(u8 * packet)
+{
+  TERMINAL_FACE = packetSource(packet); // remember where this request came from
+  TABLE_CLEAR = true; // draw the whole table afresh
+  TELEMETRY_MODE = 0; // the table takes over from any telemetry stream
 
-  for (u32 i = 0; i < NODE_COUNT; ++i)
-    { // Look for an existing match in the list of previous PING'ers
-      if (ID == ID_NODE_ARR[i])
-        {
-          if (TIME != TS_NODE_ARR[i])
-            { // If there is a match and it is a new packet
-              if (PC_NODE_ARR[i] < 0xffff) // Make sure ping count won't overflow
-                ++PC_NODE_ARR[i]; // So we can keep track of the valid packet
-              else
-                // Notify us if the ping count will overflow
-                logNormal("Limit of pings reached for IXM %t\n", ID);
+  if (INVALID == TABLE_ALARM) // one alarm is enough, however often we're asked
+    TABLE_ALARM = Alarms.create(printTable);
 
-              TS_NODE_ARR[i] = TIME; // Update nodular time-stamp
-              TS_HOST_ARR[i] = millis(); // Update host-based time-stamp
+  Alarms.set(TABLE_ALARM, millis()); // schedule the table printouts
 
-              return i; // Return the location of the existing node
-            }
+  return;
+}
 
-          else
-            // Don't forward the packet if it isn't new
-            return INVALID;
-        }
-    }
+/*
+ * Summary:     Prints the counts of one row of packet counters, leaving the row
+ *              open for a caller to finish.
+ * Parameters:  u32 face to print on, counters.
+ * Return:      None.
+ */
+void
+printCounters(u32 FACE, struct COUNTERS *C)
+{
+  facePrintf(FACE, "%10d%10d%10d%10d%10d", C->rx, C->fwd, C->dup, C->spam,
+      C->stale);
 
-  // Otherwise check to see if there is any free space left in the array
-  if (NODE_COUNT >= (sizeof(ID_NODE_ARR) / sizeof(u32)))
-    {
-      logNormal("Inadequate memory space in ID table.\n"
-        "Rebooting.\n");
-      reenterBootloader(); // Clear out memory for new boards
-    }
+  return;
+}
 
-  // Add the new IXM board to the phone-book.
-  ID_NODE_ARR[NODE_COUNT] = ID;
-  TS_NODE_ARR[NODE_COUNT] = TIME;
-  TS_HOST_ARR[NODE_COUNT] = millis();
-  ++PC_NODE_ARR[NODE_COUNT];
+/*
+ * Summary:     Prints one histogram as a row of bucket counts.
+ * Parameters:  u32 face to print on, row label, histogram.
+ * Return:      None.
+ */
+void
+printHistogram(u32 FACE, const char *LABEL, struct HISTOGRAM *H)
+{
+  facePrintf(FACE, "%s", LABEL);
 
-  return NODE_COUNT++; // And pass it on
+  for (u32 i = 0; i < HIST_BUCKETS; ++i)
+    facePrintf(FACE, "%7d", H->bucket[i]);
+
+  facePrintf(FACE, "%8d\n", H->max);
+
+  return;
 }
 
 /*
- * Summary:     Handles (r)esult packet reflex.  Packet information is logged and
- *              result is logged for the specific calculation.
- * Parameters:  (r)esult packet.
+ * Summary:     Handles (s)tatistics packet reflex.  Prints the packet counters
+ *              and timing histograms once, below the table if one is shown.
+ * Parameters:  (s)tatistics packet.
  * Return:      None.
  */
 void
-r_handler(u8 * packet)
+s_handler(u8 * packet)
 {
-  R_PKT PKT_R;
-
-  if (packetScanf(packet, "%Zr%z\n", R_ZScanner, &PKT_R) != 3)
-    {
-      logNormal("r_handler:  Failed at %d\n", packetCursor(packet));
-      return; // Filter out bad packets
-    }
+  u32 FACE = packetSource(packet);
 
-  u32 NODE_INDEX; // index holder for if log is valid
+  if (TABLE_SHOWN)
+    facePrintf(FACE, "\x1b[%d;1H\x1b[J", TABLE_SHOWN + 1); // keep clear of the table
 
-  // only log properly formatted packets
-  if (INVALID == (NODE_INDEX = log(PKT_R.key.ID, PKT_R.key.TIME)))
-    return; // Don't continue if this packet has been received before
+  facePrintf(FACE, "FACE        RX       FWD       DUP      SPAM     STALE       BAD\n");
 
-  else if (PC_NODE_ARR[NODE_INDEX] > (PKT_R.key.TIME / 1000))
+  for (u32 i = 0; i < 4; ++i)
     {
-      PC_NODE_ARR[NODE_INDEX] -= 2; // Decrease the amount of pings recorded, "spammer amnesty" of sorts
-      return; // But don't continue if this IXM is spamming packets right now
+      facePrintf(FACE, "%4d", i);
+      printCounters(FACE, &FACE_COUNT_ARR[i]);
+      facePrintf(FACE, "%10d\n", FACE_COUNT_ARR[i].bad);
     }
 
-  else if (PKT_R.doa_ver < HOST_DOA_VER) // Don't continue if this is an old calculation
-    return; // But it's expected at times
+  facePrintf(FACE, "ID          RX       FWD       DUP      SPAM     STALE\n");
 
-  else if (0xffffffff == PKT_R.doa_ver)
+  for (u32 i = 1; i < NODE_COUNT; ++i)
     {
-      logNormal("r_handler: Received DOA version overflow.\n");
-      return; // You should really consider unplugging that board!
+      facePrintf(FACE, "%04t", ID_NODE_ARR[i]);
+      printCounters(FACE, &NODE_ARR[i].count);
+      facePrintf(FACE, "\n");
     }
 
-  // If all the hoops have been jumped through
-  FWD_R_PKT(&PKT_R, packetSource(packet)); // Forward the packet
+  facePrintf(FACE, "UNDER MS");
 
-  if (0 == PKT_R.round) // If an IXM was hot-swapped in during a calculation
-    return; // It should not continue
+  for (u32 i = 0; i < HIST_BUCKETS - 1; ++i)
+    facePrintf(FACE, "%7d", HIST_BASE << i);
 
-  if (PKT_R.doa_ver > HOST_DOA_VER) //If this is a new calculation
-    { // perform standard procedures
-      calcFlush();
+  facePrintf(FACE, "   MORE     MAX\n");
+  printHistogram(FACE, "ROUND   ", &ROUND_HIST);
+  printHistogram(FACE, "RESULT  ", &LATENCY_HIST);
 
-      if (fabs(PKT_R.round - ROUND_NODE_ARR[0]) > 1) // If an IXM was hot-swapped in
-        return; // It should ignore the calculation
+  return;
+}
+
+/*
+ * Summary:     Reboots the board once the reboot signal has had time to spread.
+ * Parameters:  Time when function was called (handled automagically).
+ * Return:      None.
+ */
+void
+rebootBoard(u32)
+{
+  reenterBootloader(); // Clear out memory for new boards
+
+  return; // Never actually returns
+}
 
-      HOST_DOA_1 = PKT_R.doa1; // Preserve the DOA pieces for forwarding
-      HOST_DOA_2 = PKT_R.doa2;
+#ifdef SYNERGY_PROFILE
+/*
+ * Summary:     Charges the time of one call to a probe.
+ * Parameters:  u32 probe, u32 time in microseconds.
+ * Return:      None.
+ */
+void
+probeAdd(u32 PROBE_ID, u32 TIME)
+{
+  struct PROBE *P = &PROBE_ARR[PROBE_ID];
+  u32 i = 0;
 
-      HOST_DOA = doaConvert(HOST_DOA_1, HOST_DOA_2); // Remember the new DOA
-      HOST_DOA_VER = PKT_R.doa_ver; // Remember the version of the new DOA
-      RUN_TIME_START = millis(); // note the start time for the new calculation
-    }
+  while ((i < PROBE_BUCKETS - 1) && (TIME >= (2u << i)))
+    ++i;
 
-  updateResult(NODE_INDEX, PKT_R.result, PKT_R.round); // and update
+  ++P->bucket[i];
+
+  if ((0 == P->count) || (TIME < P->min))
+    P->min = TIME;
+
+  if (TIME > P->max)
+    P->max = TIME;
+
+  P->total += TIME;
+  ++P->count;
 
   return;
 }
 
 /*
- * Summary:     Handles (d)istribute packet reflex.  Packet information is saved
- *              and converted into a R packet to be forwarded to neighboring nodes.
- * Parameters:  (d)istribute packet.
+ * Summary:     Estimates a percentile of a probe's times from its buckets.
+ * Parameters:  Probe, u32 percentile.
+ * Return:      u32 upper bound of the bucket holding the percentile, no more
+ *              than the longest call.
+ */
+u32
+probePercentile(struct PROBE *P, u32 PERCENT)
+{
+  u32 RANK = (P->count * PERCENT + 99) / 100; // calls at or under the percentile
+  u32 SEEN = 0;
+
+  for (u32 i = 0; i < PROBE_BUCKETS - 1; ++i)
+    if ((SEEN += P->bucket[i]) >= RANK)
+      return (((2u << i) - 1 < P->max) ? (2u << i) - 1 : P->max);
+
+  return P->max;
+}
+#endif
+
+/*
+ * Summary:     Handles (c)ost packet reflex.  Prints the time spent in each
+ *              probe once, below the table if one is shown.
+ * Parameters:  (c)ost packet.
  * Return:      None.
  */
 void
-d_handler(u8 * packet)
+c_handler(u8 * packet)
 {
-  D_PKT PKT_R;
+  u32 FACE = packetSource(packet);
 
-  if (packetScanf(packet, "%Zd%z\n", D_ZScanner, &PKT_R) != 3)
+  if (TABLE_SHOWN)
+    facePrintf(FACE, "\x1b[%d;1H\x1b[J", TABLE_SHOWN + 1); // keep clear of the table
+
+#ifdef SYNERGY_PROFILE
+  facePrintf(FACE,
+      "PROBE               CALLS     MIN    MEAN     MAX     P50     P90     P99    TOTAL MS\n");
+
+  for (u32 i = 0; i < PROBE_COUNT; ++i)
     {
-      logNormal("Failed at %d\n", packetCursor(packet));
-      return;
+      struct PROBE *P = &PROBE_ARR[i];
+
+      facePrintf(FACE, "%s", PROBE_NAME_ARR[i]);
+
+      for (u32 j = strlen(PROBE_NAME_ARR[i]); j < 14; ++j)
+        facePrintf(FACE, " ");
+
+      facePrintf(FACE, "%11d%8d%8d%8d%8d%8d%8d%12d\n", P->count, P->min,
+          (P->count ? (u32) (P->total / P->count) : 0), P->max,
+          probePercentile(P, 50), probePercentile(P, 90), probePercentile(P,
+              99), (u32) (P->total / 1000));
     }
+#else
+  facePrintf(FACE, "Profiling is compiled out; build with SYNERGY_PROFILE defined.\n");
+#endif
+
+  return;
+}
+
+/*
+ * Summary:     Handles (x) packet reflex:  Reboot signal.
+ * Parameters:  'x' packet.
+ * Return:      None.
+ */
+void
+x_handler(u8 * packet)
+{
+  if (packetScanf(packet, "x\n") != 2)
+    return;
 
-  calcFlush(); // clear out my records for the new session
+  facePrintln(ALL_FACES, "x"); // Be indiscrimnate to all faces
+  Alarms.set(Alarms.create(rebootBoard), millis() + REBOOT_DELAY); // Give some time for the action to be performed
 
-  HOST_DOA_1 = PKT_R.doa1;
-  HOST_DOA_2 = PKT_R.doa2;
-  ++HOST_DOA_VER;
+  return;
+}
 
-  HOST_DOA = doaConvert(HOST_DOA_1, HOST_DOA_2);
+/*
+ * Summary:     Handles (m)onitor packet reflex.  Starts or stops the telemetry
+ *              stream on the requesting face.
+ * Parameters:  (m)onitor packet.
+ * Return:      None.
+ */
+void
+m_handler(u8 * packet)
+{
+  u8 MODE;
+  u32 RATE = 1;
+  u32 MATCHED;
 
-  if (HOST_DOA < 0.0)
+  if (packetScanf(packet, "m%c", &MODE) != 2)
     {
-      logNormal("d_handler:  Input %f must be a non-negative integer.\n",
-          HOST_DOA);
+      logNormal("m_handler:  Failed at %d\n", packetCursor(packet));
+      ++FACE_COUNT_ARR[packetSource(packet) & 3].bad;
       return;
     }
 
-  if (HOST_DOA > DOA_THRESHOLD)
+  if (((MATCHED = packetScanf(packet, ",%d", &RATE)) != 0) && (MATCHED != 2))
     {
-      logNormal(
-          "d_handler:  Degree of accuracy %f must be less than the threshold %f.\n",
-          HOST_DOA, DOA_THRESHOLD);
+      logNormal("m_handler:  Inconsistent rate.\n");
+      ++FACE_COUNT_ARR[packetSource(packet) & 3].bad;
       return;
     }
 
-  R_PKT PKT_T;
+  if ('0' == MODE)
+    {
+      TELEMETRY_MODE = 0;
+      return;
+    }
+
+  if ((('c' != MODE) && ('j' != MODE)) || (0 == RATE))
+    {
+      logNormal("m_handler:  Mode %c must be c, j or 0 and the rate at least 1.\n",
+          MODE);
+      return;
+    }
 
-  // Relevant R packet info
-  PKT_T.key.ID = ID_NODE_ARR[0];
-  PKT_T.key.TIME = millis();
-  PKT_T.doa_ver = ++HOST_DOA_VER;
-  PKT_T.doa1 = HOST_DOA_1;
-  PKT_T.doa2 = HOST_DOA_2;
-  PKT_T.round = HOST_ROUND;
-  PKT_T.result = HOST_RESULT;
+  TERMINAL_FACE = packetSource(packet); // the stream goes where it was asked for
+  TELEMETRY_MODE = MODE;
+  TELEMETRY_RATE = RATE;
+  TABLE_LINE = INVALID; // the table gives way, mid-refresh or not
+  TABLE_CLEAR = true;
 
-  // If all the hoops have been jumped through
-  FWD_R_PKT(&PKT_T, packetSource(packet)); // Forward the result packet
-  RUN_TIME_START = millis(); // note the start time for the calculation
+  for (u32 i = 0; i < MAX_JOBS; ++i) // open every job with absolute values
+    JOB_ARR[i].records = 0;
 
   return;
 }
 
 /*
- * Summary:  Sends a packet containing BoardID to all faces on interval and
- * evaluates activity/inactivity status of boards.
- * Parameters:  Time when function was called, handled automatically
- * Return:  None
+ * Summary:     Evaluates activity/inactivity status of boards and keeps track of
+ *              the active ones.  A board gone idle is taken out of the running
+ *              jobs, so their rounds don't wait on it.  Its time-stamp is kept,
+ *              so its old packets still count as duplicates.
+ * Parameters:  u32 time to judge the silence of each board against.
+ * Return:      None.
  */
 void
-printTable(u32 when)
+evaluateNodes(u32 NOW)
 {
-  if (when < 0)
-    {
-      logNormal("log:  No time-traveling or overflow allowed!\n");
-      API_ASSERT_GREATER_EQUAL(when, 0); // blinkcode!
-    }
+  ACTIVE_NODE_COUNT = 1; // recounted from scratch on every evaluation
+  bool ACTIVE_STATE; // used to keep track of the previous state
 
-  u32 HOST_TIME = when;
+  nodeMark(ACTIVE_NODE_SET, 0, true); // our node is always active
 
-  facePrintf(
-      TERMINAL_FACE,
-      "\n\n\n\n\n\n\n\n\n\n\n\n+======================================================================+\n");
+  for (u32 i = 1; i < NODE_COUNT; ++i)
+    { // evaluate non-host IXM activity/inactivity
+      ACTIVE_STATE = nodeIn(ACTIVE_NODE_SET, i); // Store the state before evaluating the current state
+      bool ACTIVE = ((s32) (NOW - heardTime(i)) < (s32) idleLimit(i)); // a node heard after NOW is active
 
-  // DOA = degree of accuracy
-  // Forgive this primitive space-handling, but facePrintf lacks a graceful way to do this
-  if (0.0 == HOST_DOA)
-    facePrintf(
-        TERMINAL_FACE,
-        "|DOA: --                      HOST TIME: %010d                    |\n",
-        HOST_TIME);
-  else if (HOST_DOA < 10.0) // 4 characters
-    facePrintf(
-        TERMINAL_FACE,
-        "|DOA: %3f%%                   HOST TIME: %010d                    |\n",
-        HOST_DOA, HOST_TIME);
+      nodeMark(ACTIVE_NODE_SET, i, ACTIVE); // Displays activity/inactivity on the table
 
-  else if (HOST_DOA < 100.0) // 5 characters
-    facePrintf(TERMINAL_FACE,
-        "|DOA: %4f%%                   HOST TIME: %010d                   |\n",
-        HOST_DOA, HOST_TIME);
+      if (!ACTIVE) // Inactive sequences are kept track of in case of state changes
+        {
+          NODE_ARR[i].pings = 0;
+          NODE_ARR[i].neighbor = 0; // until it pings again, wherever it comes back
+
+          for (u32 j = 0; j < MAX_JOBS; ++j)
+            if ((NO_JOB != JOB_ARR[j].id) && nodeIn(JOB_ARR[j].seq_set, i))
+              { // The job can't wait for its results any longer
+                nodeMark(JOB_ARR[j].seq_set, i, false);
+                --JOB_ARR[j].node_count;
+              }
+        }
 
-  else
-    // 6 characters
-    facePrintf(TERMINAL_FACE,
-        "|DOA: %5f%%                  HOST TIME: %010d                   |\n",
-        HOST_DOA, HOST_TIME);
-
-  facePrintf(TERMINAL_FACE,
-      "+----------------------------------------------------------------------+\n");
-  facePrintf(TERMINAL_FACE,
-      "|ID       ACTIVE     TIME-STAMP     SEQ      PINGS     ROUND     RESULT|\n");
-  facePrintf(TERMINAL_FACE,
-      "+----     ------     ----------     ----     -----     -----     ------+\n");
+      else // keep track of the active nodes in case of state changes
+        ++ACTIVE_NODE_COUNT;
 
-  for (u32 i = 0; i < NODE_COUNT; ++i)
-    {
-      facePrintf(TERMINAL_FACE, "|%04t          %c%15d%9d%10d%10d%11d|\n",
-          ID_NODE_ARR[i], ACTIVE_NODE_ARR[i], TS_HOST_ARR[i], SEQ_NODE_ARR[i],
-          PC_NODE_ARR[i], ROUND_NODE_ARR[i], RESULT_NODE_ARR[i]);
+      if (ACTIVE_STATE != ACTIVE) // If there was a state change
+        {
+          if (ACTIVE)
+            logNormal("IXM %04t has joined the synergy.\n", ID_NODE_ARR[i]);
+          else
+            logNormal("IXM %04t has left the synergy.\n", ID_NODE_ARR[i]);
+        }
     }
 
-  facePrintf(TERMINAL_FACE,
-      "+----------------------------------------------------------------------+\n");
+  for (u32 j = 0; j < MAX_JOBS; ++j)
+    if (NO_JOB != JOB_ARR[j].id)
+      compileResults(&JOB_ARR[j]); // Rounds that only waited on idle nodes are complete
 
-  if (0 == HOST_DOA)
-    facePrintf(TERMINAL_FACE,
-        "|PI ESTIMATE: --               RUN TIME: --                            |\n");
+  return;
+}
 
-  else
-    {
-      facePrintf(TERMINAL_FACE, "|PI ESTIMATE: 3.");
+/*
+ * Summary:     Handles (w)rite trace packet reflex.  Prints the packet trace,
+ *              oldest event first, and starts a new one.  The first line gives
+ *              the IXM's ID and the events traced and lost since the last
+ *              dump; then each event is a "T" line of base-36 fields: time,
+ *              kind and face, ID, TIME, job, weight, round, DOA (whole), DOA
+ *              (decimal), result.
+ * Parameters:  (w)rite trace packet.
+ * Return:      None.
+ */
+void
+w_handler(u8 * packet)
+{
+  u32 FACE = packetSource(packet);
 
-      // This must be my PURGATORY for taking printf for granted
-      for (u32 i = 0; i <= ((PRECISION / 2) - 1); ++i)
-        facePrintf(TERMINAL_FACE, "%02d", (int) ((CALC_PI * pow(100, i + 1))
-            - (double) ((int) (CALC_PI * pow(100, i))) * 100)); // sadness
+#ifdef SYNERGY_TRACE
+  u32 KEPT = ((TRACE_COUNT < TRACE_LENGTH) ? TRACE_COUNT : TRACE_LENGTH);
 
-      facePrintf(TERMINAL_FACE, "     RUN TIME: %010d                    |\n",
-          ((0 == RUN_TIME) ? (millis() - RUN_TIME_START) : RUN_TIME));
-    }
+  facePrintf(FACE, "W%t,%d,%d\n", ID_NODE_ARR[0], TRACE_COUNT, TRACE_COUNT
+      - KEPT);
 
-  facePrintf(TERMINAL_FACE, "|PI ACTUAL:   3.");
+  for (u32 i = TRACE_COUNT - KEPT; i != TRACE_COUNT; ++i)
+    {
+      struct TRACE *T = &TRACE_ARR[i % TRACE_LENGTH];
 
-  for (u32 i = 0; i <= ((PRECISION / 2) - 1); ++i)
-    facePrintf(TERMINAL_FACE, "%d", (int) ((PI * pow(100, i + 1))
-        - (double) ((int) (PI * pow(100, i))) * 100));
+      facePrintf(FACE, "T%t,%c%d,%t,%t,%t,%t,%t,%t,%t,%t\n", T->time, T->kind,
+          T->face, T->pkt.key.ID, T->pkt.key.TIME, T->pkt.job, T->pkt.weight,
+          T->pkt.round, T->pkt.doa1, T->pkt.doa2, T->pkt.result);
+    }
 
-  facePrintf(TERMINAL_FACE, "     POINTS GENERATED: %10d            |\n",
-      (ACTIVE_NODE_COUNT * ROUND_NODE_ARR[0] * MAX_POINTS_GEN));
+  TRACE_COUNT = 0;
+#else
+  facePrintf(FACE, "Tracing is compiled out; build with SYNERGY_TRACE defined.\n");
+#endif
 
-  if (100.0 == HOST_CURRENT_DOA)
-    facePrintf(
-        TERMINAL_FACE,
-        "|                              ACCURACY ACHIEVED: %5f%%              |\n",
-        HOST_CURRENT_DOA);
-  else if (10.0 < HOST_CURRENT_DOA)
-    facePrintf(
-        TERMINAL_FACE,
-        "|                              ACCURACY ACHIEVED: %4f%%               |\n",
-        HOST_CURRENT_DOA);
+  return;
+}
 
-  else
-    facePrintf(
-        TERMINAL_FACE,
-        "|                              ACCURACY ACHIEVED: %3f%%                |\n",
-        HOST_CURRENT_DOA);
+/*
+ * Summary:     Sends a ping to every neighbor on interval and retires boards
+ *              that have fallen silent for longer than their idle limit.  The
+ *              alarm may run late, so both go by the time it actually runs.
+ * Parameters:  Time when function was called (handled automagically).
+ * Return:      None.
+ */
+void
+pingFaces(u32 when)
+{
+  u32 NOW = millis();
 
-  facePrintf(TERMINAL_FACE,
-      "+======================================================================+\n");
+  for (u32 i = 0; i < 4; ++i)
+    if (TERMINAL_FACE != i) // Nobody to time on the terminal face
+      facePrintf(i, "p%t,%d\n", ID_NODE_ARR[0], NOW);
 
-  Alarms.set(Alarms.currentAlarmNumber(), when + printTable_PERIOD); // schedule the next table printout
+  for (u32 i = 1; i < NODE_COUNT; ++i)
+    if (nodeIn(ACTIVE_NODE_SET, i) && ((s32) (NOW - heardTime(i))
+        >= (s32) idleLimit(i)))
+      { // Don't wait for the heartbeat to drop a silent board
+        evaluateNodes(NOW);
+        break;
+      }
+
+  Alarms.set(Alarms.currentAlarmNumber(), when + pingFaces_PERIOD); // schedule the next ping
 
   return;
 }
 
 /*
- * Summary:     Sets a table-printing alarm that will reset itself on interval.
- * Parameters:  (t)able packet.
+ * Summary:     Handles (p)ing packet reflex.  The ping is echoed back as a pong
+ *              and counts as a sign of life from the neighbor that sent it.
+ * Parameters:  (p)ing packet.
  * Return:      None.
  */
 void
-t_handler(u8 * packet)
+p_handler(u8 * packet)
 {
-  TERMINAL_FACE = packetSource(packet); // remember where this request came from
-  Alarms.set(Alarms.create(printTable), millis()); // schedule the table printouts
+  u32 ID; // hex ID of the neighbor
+  u32 TIME; // neighbor's time-stamp, echoed back untouched
+
+  if (packetScanf(packet, "p%t,%d\n", &ID, &TIME) != 5)
+    return;
+
+#ifdef SYNERGY_TRACE
+  R_PKT PKT_P; // the ping as the trace keeps it
+
+  memset(&PKT_P, 0, sizeof(PKT_P));
+  PKT_P.key.ID = ID;
+  PKT_P.key.TIME = TIME;
+  TRACE_EVENT('p', packetSource(packet), &PKT_P);
+#endif
+
+  facePrintf(packetSource(packet), "q%d\n", TIME);
+
+  for (u32 i = 1; i < NODE_COUNT; ++i)
+    if (ID == ID_NODE_ARR[i])
+      { // Only nodes already introduced by a (r)esult packet
+        heardFrom(i);
+        NODE_ARR[i].face = packetSource(packet);
+        NODE_ARR[i].neighbor = 1; // so it is missed as soon as its pings are
+        break;
+      }
 
   return;
 }
 
 /*
- * Summary:     Handles (x) packet reflex:  Reboot signal.
- * Parameters:  'x' packet.
+ * Summary:     Handles (q) pong packet reflex:  Round-trip time measurement.
+ * Parameters:  (q) pong packet.
  * Return:      None.
  */
 void
-x_handler(u8 * packet)
+q_handler(u8 * packet)
 {
-  if (packetScanf(packet, "x\n") != 2)
+  u32 TIME; // our own time-stamp from the ping
+
+  if (packetScanf(packet, "q%d\n", &TIME) != 3)
     return;
 
-  facePrintln(ALL_FACES, "x"); // Be indiscrimnate to all faces
-  delay(500); // Give some time for the action to be performed
-  reenterBootloader(); // Clear out memory for new boards
+  u8 FACE = packetSource(packet);
 
-  return; // Never actually returns
+  smoothSample(&RTT_FACE_ARR[FACE], &RTT_DEV_FACE_ARR[FACE], millis() - TIME);
+
+  return;
 }
 
 /*
- * Summary:     Sends an r packet containing basic info to all faces on interval
- *              and evaluates activity/inactivity status of boards.
+ * Summary:     Sends an r packet per job containing basic info to all faces on
+ *              interval and evaluates activity/inactivity status of boards.
  * Parameters:  Time when function was called (handled automagically).
  * Return:      None.
  */
 void
 heartBeat(u32 when)
 {
+  PROFILE(PROBE_HEART_BEAT);
+
   // synthesize a new packet
   R_PKT PKT_T;
+  bool SENT = false;
 
-  PKT_T.key.TIME = millis();
+  TRACE_EVENT('h', 0, 0);
 
-  if (PC_NODE_ARR[0] > (PKT_T.key.TIME / 1000)) // Spam self-safeguard
-    {
-      PC_NODE_ARR[0] -= 2; // self "spammer amnesty"
-      return;
-    }
+  for (u32 i = 0; i < MAX_JOBS; ++i)
+    if (NO_JOB != JOB_ARR[i].id)
+      {
+        struct JOB *J = &JOB_ARR[i];
+
+        if (J->round == J->beat_round)
+          { // The round was gathered all heartbeat long, so some results were lost
+            hostR_PKT(J, J->round, &PKT_T); // Resend the round, or announce the job if not sampled
+            SENT |= sendOwn(&PKT_T);
+            resendRounds(J, J->round + 1, ROUND_WINDOW - 1); // and the rest of the window too
+          }
 
-  PKT_T.key.ID = ID_NODE_ARR[0];
-  PKT_T.doa1 = HOST_DOA_1;
-  PKT_T.doa2 = HOST_DOA_2;
-  PKT_T.doa_ver = HOST_DOA_VER;
-  PKT_T.result = RESULT_NODE_ARR[0]; // Always broadcasting last result
-  PKT_T.round = ROUND_NODE_ARR[0];
+        J->beat_round = J->round;
+      }
 
-  BRD_R_PKT(&PKT_T);
-  ++PC_NODE_ARR[0]; // update recent host ping count
-  TS_HOST_ARR[0] = TS_NODE_ARR[0] = PKT_T.key.TIME; // update recent host ping times
-  ACTIVE_NODE_COUNT = 0; // used to count how many state changes occurred
-  char ACTIVE_STATE; // used to keep track of the previous state
+  if (!SENT && ((s32) (millis() - NODE_ARR[0].stamp) >= (s32) pingAll_PERIOD))
+    { // Nothing sent all heartbeat long, but the grid still needs to know we're here
+      hostR_PKT(0, 0, &PKT_T);
+      sendOwn(&PKT_T);
+    }
 
-  ACTIVE_ID_NODE_ARR[ACTIVE_NODE_COUNT++] = ID_NODE_ARR[0]; // our node is always active
+  ++NODE_ARR[0].pings; // update recent host ping count
+  heardNow(0); // update recent host ping times
+  evaluateNodes(heardTime(0)); // see who is still around
 
-  for (u32 i = 1; i < NODE_COUNT; ++i)
-    { // evaluate non-host IXM activity/inactivity
-      ACTIVE_STATE = ACTIVE_NODE_ARR[i]; // Store the state before evaluating the current state
-      ACTIVE_NODE_ARR[i] = (((TS_HOST_ARR[0] - TS_HOST_ARR[i]) < IDLE) ? 'A'
-          : 'I'); // Displays activity/inactivity on the table
+  Alarms.set(Alarms.currentAlarmNumber(), when + pingAll_PERIOD); // schedule the next heart-beat
 
-      if ('I' == ACTIVE_NODE_ARR[i]) // Inactive sequences are kept track of in case of state changes
-        RESULT_NODE_ARR[i] = PC_NODE_ARR[i] = 0; // Also clear out the previous result
+  return;
+}
+
+/*
+ * Summary:     Steps the flashing signal:  turns the LED on or off on interval
+ *              and restores the previous LED state once it is done.
+ * Parameters:  Time when function was called (handled automagically).
+ * Return:      None.
+ */
+void
+flashStep(u32 when)
+{
+  if (FLASH_STEP >= 2 * FLASH_COUNT)
+    { // Signal is over
+      for (u32 k = 0; k < 3; ++k)
+        if (FLASH_PIN_STATE[k])
+          ledOn(LED_PIN[k]); // Restore the state of the LED lights
 
-      else if ('A' == ACTIVE_NODE_ARR[i]) // keep track of the active nodes in case of state changes
-        ACTIVE_ID_NODE_ARR[ACTIVE_NODE_COUNT++] = ID_NODE_ARR[i];
+      FLASH_LED = OFF;
 
-      if (ACTIVE_STATE != ACTIVE_NODE_ARR[i]) // If there was a state change
-        {
-          if ('A' == ACTIVE_NODE_ARR[i])
-            {
-              ++ACTIVE_NODE_COUNT;
-              logNormal("IXM %04t has joined the synergy.\n",
-                  ACTIVE_ID_NODE_ARR[i]);
-            }
-          else
-            {
-              --ACTIVE_NODE_COUNT;
-              logNormal("IXM %04t has left the synergy.\n",
-                  ACTIVE_ID_NODE_ARR[i]);
-            }
-        }
+      return;
     }
 
-  compileResults(); // A round is evaluated every heartbeat
-  CALCULATE_TX_FLAG = true;
-  Alarms.set(Alarms.currentAlarmNumber(), when + pingAll_PERIOD); // schedule the next heart-beat
+  if (0 == (FLASH_STEP++ % 2))
+    ledOn(LED_PIN[FLASH_LED]);
+  else
+    ledOff(LED_PIN[FLASH_LED]);
+
+  Alarms.set(Alarms.currentAlarmNumber(), when + FLASH_STATUS_PERIOD); // schedule the next step
 
   return;
 }
 
 /*
  * Summary:     Signals whether this specific board is initialized
- *              3 flashes with half-second interval;
+ *              3 flashes with half-second interval.  The flashing runs off an
+ *              alarm, so the board carries on while it flashes.
  * Parameters:  u32 led status
  * Return:      None.
  */
 void
 flashSignal(u32 STATUS_LED)
 {
-  bool LED_PIN_STATE[3] =
-    { false };
+  if (OFF != FLASH_LED)
+    return; // Already signaling
 
   for (u32 i = 0; i < 3; ++i)
     { // Preserve the state of the LED lights
-      LED_PIN_STATE[i] = ledIsOn(LED_PIN[i]);
+      FLASH_PIN_STATE[i] = ledIsOn(LED_PIN[i]);
       ledOff(LED_PIN[i]); // Turn off the light
     }
 
-  for (u32 j = 0; j < 3; ++j)
-    { // Flash thrice if faulty or not
-      ledOn(STATUS_LED);
-      delay(FLASH_STATUS_PERIOD);
+  FLASH_LED = STATUS_LED;
+  FLASH_STEP = 0;
 
-      ledOff(STATUS_LED);
-      delay(FLASH_STATUS_PERIOD);
-    }
+  if (INVALID == FLASH_ALARM)
+    FLASH_ALARM = Alarms.create(flashStep);
 
-  for (u32 k = 0; k < 3; ++k)
-    if (LED_PIN_STATE[k])
-      ledOn(LED_PIN[k]); // Restore the state of the LED lights
+  Alarms.set(FLASH_ALARM, millis()); // Flash thrice if faulty or not
 
   return;
 }
@@ -936,31 +2651,91 @@ setup()
 {
   // Initialize reflexes
   Body.reflex('r', r_handler);
+  Body.reflex('b', b_handler);
   Body.reflex('d', d_handler);
   Body.reflex('t', t_handler);
+  Body.reflex('s', s_handler);
+  Body.reflex('c', c_handler);
+  Body.reflex('m', m_handler);
+  Body.reflex('w', w_handler);
   Body.reflex('x', x_handler);
+  Body.reflex('p', p_handler);
+  Body.reflex('q', q_handler);
 
   // Initialize host values
   ID_NODE_ARR[0] = getBootBlockBoardId();
-  ACTIVE_NODE_ARR[0] = 'A';
-  SEQ_NODE_ARR[0] = 1;
-  HOST_ROUND = 0;
+  nodeMark(ACTIVE_NODE_SET, 0, true);
+
+  for (u32 i = 0; i < SAMPLE_LANES; ++i) // xorshift must never hold zero
+    SAMPLE_LANE_ARR[i] = (random(0, 0x10000) << 16) | random(1, 0x10000);
+
+  // so that a rebooted IXM doesn't issue its earlier job ID's again
+  JOB_SERIAL = (random(0, 0x10000) << 16) | random(0, 0x10000);
+
+  for (u32 i = 0; i < 4; ++i)
+    bucketFill(&FACE_BUCKET_ARR[i], FACE_BUCKET_DEPTH);
 
   Alarms.set(Alarms.create(heartBeat), pingAll_PERIOD); // Start the heartbeats
+  Alarms.set(Alarms.create(pingFaces), pingFaces_PERIOD); // Start timing the neighbors
   flashSignal(GREEN); // HE LIVES!
 
   return;
 }
 
 /*
- * Summary:     Puts IXM in a "listening state".
+ * Summary:     Sends queued packets; a task step for loop().
+ * Parameters:  None.
+ * Return:      Boolean confirming work is left (never, tokens permitting).
+ */
+bool
+txStep()
+{
+  flushQueues();
+
+  return false;
+}
+
+/*
+ * Summary:     Generates a small batch of points; a task step for loop().
+ * Parameters:  None.
+ * Return:      Boolean confirming a job still wants points.
+ */
+bool
+computeStep()
+{
+  for (u32 i = 0; i < COMPUTE_BATCH; ++i)
+    if (!calculate())
+      return false;
+
+  return true;
+}
+
+/*
+ * Summary:     Tasks handed a slice of every loop, most urgent first.  Reflexes
+ *              and alarms run between loops, so the slices bound their wait.
+ */
+struct TASK TASK_ARR[] =
+  {
+    { txStep, TX_SLICE },
+    { tableStep, TABLE_SLICE },
+    { computeStep, COMPUTE_SLICE } };
+
+/*
+ * Summary:     Puts IXM in a "listening state".  Each task steps until it runs
+ *              out of work or out of its time budget, then the next one goes.
  * Parameters:  None.
  * Return:      None.
  */
 void
 loop()
 {
-  calculate(); // generate another random point
+  for (u32 i = 0; i < sizeof(TASK_ARR) / sizeof(TASK_ARR[0]); ++i)
+    {
+      u32 START = micros();
+
+      while (TASK_ARR[i].step() && ((micros() - START) < TASK_ARR[i].budget))
+        ;
+    }
 }
 
 #define SFB_SKETCH_CREATOR_ID B36_4(n,a,s,a)
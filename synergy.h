@@ -15,64 +15,207 @@
 #include <stdio.h>
 #include <math.h>
 
+#ifndef SYNERGY_STATE
+#define SYNERGY_STATE // marks per-board state, which host tools may gather into one section
+#endif
+
+#ifndef SYNERGY_ARR_LENGTH
+#define SYNERGY_ARR_LENGTH 32 // boards the tables have room for; host simulations of larger grids raise it
+#endif
+
 #define INVALID 0xffffffff
 #define OFF 0xffffffff
 #define RED 0
 #define GREEN 1
 #define BLUE 2
+#define PRIO_RELAY 0
+#define PRIO_FRESH 1
+#define NO_JOB 0
+#define PROBE_CALCULATE 0
+#define PROBE_R_HANDLER 1
+#define PROBE_D_HANDLER 2
+#define PROBE_LOG 3
+#define PROBE_COMPILE_RESULTS 4
+#define PROBE_HEART_BEAT 5
+#define PROBE_PRINT_TABLE 6
+#define PROBE_TABLE_STEP 7
+#define PROBE_R_ZPRINTER 8
+#define PROBE_R_ZSCANNER 9
+#define PROBE_D_ZSCANNER 10
+#define PROBE_FWD_R_PKT 11
+#define PROBE_FLUSH_QUEUES 12
+#define PROBE_B_HANDLER 13
+#define PROBE_COUNT 14
 
 const float DOA_THRESHOLD = 100.0; // A board can only come as close to PI as 100%
 const u16 IDLE = 5000; // limit for absence of ping until IXM node is considered idle
-const u32 RADIUS = 1000; // radius for the circle used in the pi calculation
-const u32 ARR_LENGTH = 32; // maximum array length
+const u32 IDLE_DEV_FACTOR = 4; // deviations of packet spacing tolerated before a node is idle
+const u32 IDLE_WARMUP = 8; // packet spacings measured before a node's own idle limit is trusted
+const u32 HEARD_SPAN = 0x8000; // how far back the host times nodes were last heard at are kept exactly
+const u32 RADIUS = 1000; // radius for the circle used in the pi calculation; sampling is fastest at one less than a power of two
+const u32 RADIUS_SQUARED = RADIUS * RADIUS; // largest x^2 + y^2 of a point within the circle
+const u32 ARR_LENGTH = SYNERGY_ARR_LENGTH; // maximum array length
+const u32 NODE_WORDS = (ARR_LENGTH + 31) / 32; // words of a bitset with a bit per node
 const u16 pingAll_PERIOD = 1000; // interval for board pinging
+const u16 IDLE_MIN = 3 * pingAll_PERIOD; // shortest absence of ping that can mark an IXM node beyond the neighbors idle; results come quicker than heartbeats, but only heartbeats are sure to come
+const u32 IDLE_PINGS = 4; // face pings a neighbor may go without, on top of the face's round trip, before it is idle
+const u16 pingFaces_PERIOD = 100; // interval for measuring round trips to neighbors
 const u16 printTable_PERIOD = 500; // interval for board pinging
 const u32 FLASH_STATUS_PERIOD = 500; // flashing interval
-const double PI = atan(1.0) * 4.0; // HARD, COLD PI (read "I don't need no stinking, predefined constant")
-const u32 MAX_POINTS_GEN = 1000; // maximum points generated per heartbeat
+const u32 FLASH_COUNT = 3; // flashes per signal
+const u32 REBOOT_DELAY = 500; // time given to the reboot signal to spread before rebooting
+const u32 TX_SLICE = 500; // microseconds per loop for sending queued packets
+const u32 TABLE_SLICE = 1000; // microseconds per loop for printing the table
+const u32 COMPUTE_SLICE = 2000; // microseconds per loop for generating points
+const u32 COMPUTE_BATCH = 1; // calls of calculate() between looks at the clock
+const u32 TABLE_WIDTH = 72; // characters per table line, borders included
+const double PI = 3.14159265358979323846; // HARD, COLD PI (read "I don't need no stinking, predefined constant")
+const double PI_PERCENT = 100.0 / PI; // accuracy lost per unit of error in an estimate of PI
+const u32 MAX_POINTS_GEN = 1000; // points generated by each board per round; a multiple of SAMPLE_LANES
+const u32 ROUND_WINDOW = 4; // rounds of a job a board may sample before the oldest of them is compiled
+const u32 ROUND_SLOTS = 2 * ROUND_WINDOW; // rounds of results held per node, as other boards may be a window ahead
+const u32 SHARE_SPAN = 0x4000; // rounds behind its job a node's newest result is still shown for
+const u32 SHARE_SWEEP = 0x1000; // rounds between looks for results that fell further behind than that
+const u32 SAMPLE_LANES = 8; // random streams the sampling kernel takes turns on
+const u32 SAMPLE_BATCH = 16; // most points generated per call of calculate(); a multiple of SAMPLE_LANES
 const u32 PRECISION = 10; // precision of calculated pi; must be even and less than or equal to 10
+const u32 MAX_JOBS = 4; // calculations that can run side by side
+const u32 MAX_WEIGHT = 16; // largest share of the sampling a job can ask for
+const u32 JOB_STRIDE = 0x10000; // scheduling distance of one point for a job of weight 1
+const u32 JOB_ID_SPREAD = 2654435761u; // odd multiplier of the issuing IXM's ID in job IDs, which sets the IXMs' runs of IDs far apart
+const u32 TABLE_LINES = 13 + ARR_LENGTH + MAX_JOBS; // most lines the table can take up
+const u32 ORIGIN_BUCKET_DEPTH = 10; // packets an IXM may burst before its relays are throttled (a window of rounds and then some)
+const u32 ORIGIN_REFILL_PERIOD = 100; // time for an IXM to earn back one packet
+const u32 SEND_BUCKET_DEPTH = ORIGIN_BUCKET_DEPTH - ROUND_WINDOW; // packets of its own the host may burst; relays keep the rest of their allowance for packets bunching up on the way
+const u32 SEND_PERIOD = ORIGIN_REFILL_PERIOD + ORIGIN_REFILL_PERIOD / 10; // time for the host to earn back a packet of its own; slower than relays earn, as clocks drift
+const u32 SEND_RESERVE = 2; // packets of its own that new rounds leave to heartbeats and resends
+const u32 FACE_BUCKET_DEPTH = 8; // packets a face may burst before output is throttled
+const u32 FACE_REFILL_PERIOD = 5; // time for a face to earn back one packet
+const u32 TX_QUEUE_LENGTH = 16; // maximum outgoing packets held back per face
+const u32 BATCH_SIZE = 4; // most results sent together in one (b)atch packet; 1 sends each on its own
+const u32 BATCH_DEADLINE = 10; // longest a queued result waits for a batch to fill up
+const u32 HIST_BUCKETS = 12; // histogram buckets; bucket i counts times under (HIST_BASE << i), the last one everything longer
+const u32 HIST_BASE = 16; // upper bound of the first histogram bucket
+const u32 TELEMETRY_KEYFRAME = 32; // telemetry records per job between records with absolute values
+const u32 TRACE_LENGTH = 128; // newest events kept by the packet trace
+const u32 PROBE_BUCKETS = 16; // timing buckets per probe; bucket i counts times under (2 << i) microseconds, the last one everything longer
 const u32 LED_PIN[3] = // LED PINS to cycle through
       { BODY_RGB_RED_PIN, BODY_RGB_GREEN_PIN, BODY_RGB_BLUE_PIN };
+const u64 POW10_ARR[11] = // powers of ten, up to the most decimals printed
+      { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+        10000000ull, 100000000ull, 1000000000ull, 10000000000ull };
 
-float HOST_DOA = 0.0; // degree of accuracy
-u32 HOST_DOA_1 = 0; // integer portion of DOA for forwarding
-u32 HOST_DOA_2 = 0; // decimal portion of DOA for forwarding
-u32 HOST_DOA_VER = 0; // calculation version
-u32 HOST_RESULT = 0; // count of how many random points were generated to be within the circle this round
-u32 HOST_ROUND = 0; // round of the calculation for the host board
-float HOST_CURRENT_DOA = 0.0; // keeps track of current host accuracy
-
-double CALC_PI = 0; // derived pi calculation
-double RESULT_COMPILED = 0; // result compiled from all host and nodular IXM's
-u32 ACTIVE_NODE_COUNT = 0; // count of IXM nodes
-u32 NODE_COUNT = 1; // count of IXM nodes, always includes host IXM
-u32 POINTS_GEN = 0; // running count for how many points were generated since last compile
-u32 TOTAL_CIRCLE_COUNT = 0; // running count of total points within circle from all IXM's
-
-u32 RUN_TIME_START = 0; // start time for the recent calculation
-u32 RUN_TIME = 0; // total time for the recent calculation
-
-bool CALCULATE_TX_FLAG = true; // reset every heartbeat
-u32 TERMINAL_FACE = INVALID; // terminal face for clean UI
-
-u32 ID_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // list of nodular IXM ID's
-char ACTIVE_NODE_ARR[ARR_LENGTH] =
-  { 'I' }; // list of active nodular IXM's
-u32 TS_HOST_ARR[ARR_LENGTH] =
-  { 0 }; // last-received time-stamp of nodes from host times
-u32 SEQ_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // sequence orders for the respective nodes used in calculations
-u16 PC_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // ping count for nodes
-u32 ROUND_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // result version for respective nodes
-u32 RESULT_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // result for respective nodes
-u32 ACTIVE_ID_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // temporary list of active nodular IXM ID's
-u32 TS_NODE_ARR[ARR_LENGTH] =
-  { 0 }; // last-received time-stamp of nodes from respective node packets
+/*
+ * Summary:     Checks the configuration above while compiling, so a setting
+ *              the code can't take stops the build instead of misbehaving on
+ *              the boards.
+ */
+#if __cplusplus >= 201103L
+#define STATIC_ASSERT(COND, NAME) static_assert(COND, #NAME)
+#else
+#define STATIC_ASSERT(COND, NAME) typedef char NAME[(COND) ? 1 : -1]
+#endif
+
+STATIC_ASSERT((0 == PRECISION % 2) && (PRECISION <= 10), PRECISION_must_be_even_and_at_most_10);
+STATIC_ASSERT((RADIUS > 0) && (RADIUS < 0x8000), RADIUS_must_fit_in_15_bits);
+STATIC_ASSERT(0 == MAX_POINTS_GEN % SAMPLE_LANES, MAX_POINTS_GEN_must_be_a_multiple_of_SAMPLE_LANES);
+STATIC_ASSERT(MAX_POINTS_GEN < 0x10000, MAX_POINTS_GEN_must_fit_in_16_bits);
+STATIC_ASSERT((ROUND_WINDOW > 0) && (ROUND_WINDOW < ORIGIN_BUCKET_DEPTH), ROUND_WINDOW_must_fit_in_ORIGIN_BUCKET_DEPTH);
+STATIC_ASSERT((SHARE_SWEEP > 0) && (SHARE_SPAN + SHARE_SWEEP + ROUND_SLOTS < 0x8000), shown_rounds_must_stay_within_16_bits_of_the_job);
+STATIC_ASSERT((SAMPLE_BATCH > 0) && (0 == SAMPLE_BATCH % SAMPLE_LANES), SAMPLE_BATCH_must_be_a_multiple_of_SAMPLE_LANES);
+STATIC_ASSERT((ARR_LENGTH > 0) && (ARR_LENGTH < 0x10000), ARR_LENGTH_must_fit_in_16_bits);
+STATIC_ASSERT(IDLE_WARMUP < 16, IDLE_WARMUP_must_fit_in_4_bits);
+STATIC_ASSERT((IDLE_MIN >= 2 * pingAll_PERIOD) && (IDLE_MIN <= IDLE), IDLE_MIN_must_outlast_a_lost_heartbeat);
+STATIC_ASSERT((IDLE_PINGS >= 2) && (IDLE_PINGS * pingFaces_PERIOD < IDLE_MIN), IDLE_PINGS_must_outlast_a_lost_ping_and_beat_the_heartbeats);
+STATIC_ASSERT(((IDLE + pingAll_PERIOD) << 3) < 0x10000, IDLE_must_leave_packet_spacings_in_16_bits);
+STATIC_ASSERT((IDLE + pingAll_PERIOD < HEARD_SPAN) && (HEARD_SPAN <= 0x8000), HEARD_SPAN_must_cover_IDLE_in_16_bits);
+STATIC_ASSERT((MAX_WEIGHT > 0) && (JOB_STRIDE / MAX_WEIGHT > 0), MAX_WEIGHT_must_fit_in_JOB_STRIDE);
+STATIC_ASSERT((BATCH_SIZE > 0) && (BATCH_SIZE <= TX_QUEUE_LENGTH), BATCH_SIZE_must_fit_in_TX_QUEUE_LENGTH);
+STATIC_ASSERT((MAX_JOBS > 0) && (TELEMETRY_KEYFRAME > 0) && (TRACE_LENGTH > 0), tables_must_not_be_empty);
+STATIC_ASSERT((pingAll_PERIOD > 0) && (pingFaces_PERIOD > 0) && (printTable_PERIOD > 0)
+    && (ORIGIN_REFILL_PERIOD > 0) && (FACE_REFILL_PERIOD > 0), periods_must_not_be_zero);
+STATIC_ASSERT((SEND_PERIOD > ORIGIN_REFILL_PERIOD) && (SEND_BUCKET_DEPTH < ORIGIN_BUCKET_DEPTH), SEND_BUCKET_must_stay_under_the_relay_allowance);
+STATIC_ASSERT(SEND_BUCKET_DEPTH >= SEND_RESERVE + ROUND_WINDOW, SEND_BUCKET_DEPTH_must_let_a_window_of_rounds_start_at_once);
+
+/*
+ * Summary:     log2 of a power of two, worked out while compiling.
+ */
+template<u32 N>
+  struct LOG2
+  {
+    static const u32 value = 1 + LOG2<N / 2>::value;
+  };
+
+template<>
+  struct LOG2<1>
+  {
+    static const u32 value = 0;
+  };
+
+/*
+ * Summary:     Scales 16 random bits to a coordinate in 0..SPAN-1, with a
+ *              multiply, or with a shift when SPAN is a power of two (the two
+ *              agree wherever both apply).
+ */
+template<u32 SPAN, bool POW2 = (0 == (SPAN & (SPAN - 1)))>
+  struct COORD
+  {
+    static u32
+    scale(u32 BITS)
+    {
+      return (BITS * SPAN) >> 16;
+    }
+  };
+
+template<u32 SPAN>
+  struct COORD<SPAN, true>
+  {
+    static u32
+    scale(u32 BITS)
+    {
+      return BITS >> (16 - LOG2<SPAN>::value);
+    }
+  };
+
+SYNERGY_STATE u32 ACTIVE_NODE_COUNT = 0; // count of IXM nodes
+SYNERGY_STATE u32 NODE_COUNT = 1; // count of IXM nodes, always includes host IXM
+
+SYNERGY_STATE u32 JOB_SERIAL = 0; // count of jobs issued from this IXM, from a random start each boot
+SYNERGY_STATE u32 FOCUS_JOB = 0; // job slot shown on the table, the most recently started
+SYNERGY_STATE u32 RETIRED_JOB_ARR[MAX_JOBS] =
+  { NO_JOB }; // jobs recently dropped from the table; their packets are stale
+SYNERGY_STATE u32 RETIRED_JOB_NEXT = 0; // next slot to overwrite in the retired list
+
+SYNERGY_STATE u32 TERMINAL_FACE = INVALID; // terminal face for clean UI
+SYNERGY_STATE u32 TABLE_ALARM = INVALID; // alarm that refreshes the table
+SYNERGY_STATE u32 TABLE_LINE = INVALID; // next table line to print, INVALID between refreshes
+SYNERGY_STATE u32 TABLE_TIME = 0; // host time of the refresh being printed
+SYNERGY_STATE u32 TABLE_SHOWN = 0; // lines the terminal shows from the last refresh
+SYNERGY_STATE bool TABLE_CLEAR = true; // clear the screen before the next refresh
+SYNERGY_STATE char TABLE_BUF[TABLE_WIDTH + 1] =
+  { 0 }; // table line being rendered
+SYNERGY_STATE u32 TABLE_HASH[TABLE_LINES] =
+  { 0 }; // hash of each line as the terminal shows it
+
+SYNERGY_STATE char TELEMETRY_MODE = 0; // telemetry stream format, 'c' or 'j', or 0 when off
+SYNERGY_STATE u32 TELEMETRY_RATE = 1; // rounds of a job per telemetry record
+
+SYNERGY_STATE u32 FLASH_ALARM = INVALID; // alarm that steps the flashing signal
+SYNERGY_STATE u32 FLASH_LED = OFF; // LED status being flashed
+SYNERGY_STATE u32 FLASH_STEP = 0; // LED changes made so far in the signal
+SYNERGY_STATE bool FLASH_PIN_STATE[3] =
+  { false }; // LED states to restore once the signal is over
+
+SYNERGY_STATE u32 ID_NODE_ARR[ARR_LENGTH] =
+  { 0 }; // list of nodular IXM ID's, apart from the rest so lookups scan them densely
+SYNERGY_STATE u32 ACTIVE_NODE_SET[NODE_WORDS] =
+  { 0 }; // active IXM nodes, a bit each
+SYNERGY_STATE u32 HEARD_BASE = 0; // host time the nodes' last-heard times are kept relative to
+
+SYNERGY_STATE u32 RTT_FACE_ARR[4] =
+  { 0 }; // smoothed round-trip time to the neighbor on each face (scaled by 8)
+SYNERGY_STATE u32 RTT_DEV_FACE_ARR[4] =
+  { 0 }; // smoothed deviation of the round-trip time on each face (scaled by 4)
 
 /*
  * Summary:     Distinguishing keys for IXM node and packet
@@ -87,27 +230,274 @@ struct KEY
 /*
  * Summary:     (d)istribute packet structure contains only the bare identifiers
  * Contains:    u32 degree of accuracy (whole portion), u32 degree of accuracy
- *              (decimal portion)
+ *              (decimal portion), u32 weight
  */
 struct D_PKT
 {
   u32 doa1;
   u32 doa2;
+  u32 weight;
 };
 
 /*
  * Summary:     (r)esult packet structure contains an IXM's result
- * Contains:    KEY, u32 DOA version, u32 round, u32 DOA (whole), u32 DOA (decimal),
- *              u32 result
+ * Contains:    KEY, u32 job ID, u32 job weight, u32 round, u32 DOA (whole),
+ *              u32 DOA (decimal), u32 result
  */
 struct R_PKT
 {
   struct KEY key;
-  u32 doa_ver; // denotes the doa version
+  u32 job; // denotes the calculation this result belongs to
+  u32 weight; // denotes the share of sampling the calculation gets
   u32 round; // denotes the pi circle count version
   u32 doa1; // denotes the integer portion of the DOA
   u32 doa2; // denotes the decimal portion of the DOA
   u32 result; // denotes the pi circle count
 };
 
+/*
+ * Summary:     Token bucket used to rate limit packets per origin and per face
+ * Contains:    u32 tokens available, u32 time-stamp of the last refill
+ */
+struct TOKEN_BUCKET
+{
+  u32 tokens; // packets that may still be let through
+  u32 stamp; // time the bucket was last refilled
+};
+
+/*
+ * Summary:     Bounded queue of (r)esult packets waiting for a face
+ * Contains:    R_PKT slots, priority per slot, u32 count of slots in use
+ */
+struct TX_QUEUE
+{
+  struct R_PKT pkt[TX_QUEUE_LENGTH]; // waiting packets, oldest first
+  u8 prio[TX_QUEUE_LENGTH]; // PRIO_FRESH for host results, PRIO_RELAY otherwise
+  u32 since; // time the oldest waiting packet was queued
+  u32 count; // slots in use
+};
+
+/*
+ * Summary:     Values of a telemetry record, kept as the base of the next delta
+ * Contains:    u32 round, s32 PI estimate (1e-8), s32 accuracy (1e-4 %), u32
+ *              samples, u32 active nodes, u32 run time
+ */
+struct RECORD
+{
+  u32 round; // round of the calculation
+  s32 pi; // PI estimate in units of 1e-8
+  s32 accuracy; // accuracy achieved in units of 1e-4 %
+  u32 samples; // points generated across the grid
+  u32 active; // active IXM's
+  u32 time; // run time
+};
+
+/*
+ * Summary:     A node's newest result for a job, as the table and telemetry
+ *              show it
+ * Contains:    u16 round (its low bits; read it with shareRound()), u16 result
+ */
+struct SHARE
+{
+  u16 round; // low bits of the round of the newest result heard
+  u16 result; // points within the circle that round
+};
+
+/*
+ * Summary:     A calculation in progress, keyed by the job ID its packets carry
+ * Contains:    Job ID and weight, accuracy goal and progress, host round
+ *              state, the nodes sequenced, which of their results are in for
+ *              the rounds in flight and the sums of those, the host's own
+ *              results, each node's newest result
+ */
+struct JOB
+{
+  u32 id; // job ID, NO_JOB when the slot is free
+  u32 weight; // share of the sampling relative to the other jobs
+  u32 pass; // scheduling position; the job with the lowest pass samples next
+  float doa; // degree of accuracy
+  u32 doa1; // integer portion of DOA for forwarding
+  u32 doa2; // decimal portion of DOA for forwarding
+  float current_doa; // keeps track of current host accuracy
+  u32 round; // oldest round of the calculation the host hasn't compiled yet
+  u32 sample_round; // round the host is sampling, less than ROUND_WINDOW ahead of round
+  u32 compiled; // rounds compiled into the estimate
+  u32 result; // count of how many random points were generated to be within the circle this round
+  u32 points_gen; // running count for how many points were generated since last compile
+  u32 total_circle_count; // running count of total points within circle from all IXM's
+  u32 total_points; // running count of total points generated for the rounds compiled
+  u32 node_count; // count of IXM nodes still sequenced for this job
+  double calc_pi; // derived pi calculation
+  u32 run_time_start; // start time for the calculation
+  u32 run_time; // total time for the calculation
+  u32 round_start; // time the host's current round began
+  u32 records; // telemetry records sent for the job
+  struct RECORD last_record; // values of the last telemetry record sent
+  bool tx_flag; // cleared while the host has sampled every round in its window
+  u32 beat_round; // round being gathered at the last heartbeat
+  u32 answer_time; // time rounds were last resent for a board that fell behind
+  u32 seq_set[NODE_WORDS]; // nodes sequenced when the job started, less those gone idle since, a bit each
+  u32 held_set[ROUND_SLOTS][NODE_WORDS]; // nodes whose result is in for the round in slot (round % ROUND_SLOTS), a bit each
+  u32 sum_arr[ROUND_SLOTS]; // points within the circle over the sequenced nodes' results in each slot
+  u16 count_arr[ROUND_SLOTS]; // sequenced nodes' results summed into each slot
+  u16 own_arr[ROUND_SLOTS]; // host's results, kept past compiling so they can be sent again
+  u16 own_round_arr[ROUND_SLOTS]; // low bits of the round each of the host's results belongs to; a slot is filled again every ROUND_SLOTS rounds
+  struct SHARE share_arr[ARR_LENGTH]; // newest results of respective nodes
+};
+
+SYNERGY_STATE struct JOB JOB_ARR[MAX_JOBS]; // calculations in progress
+
+/*
+ * Summary:     Work that loop() hands out in time-budgeted slices
+ * Contains:    Step function returning whether work is left, u32 budget in
+ *              microseconds per loop
+ */
+struct TASK
+{
+  bool (*step)(); // does a small, bounded piece of the work
+  u32 budget; // time the task may keep stepping within one loop
+};
+
+/*
+ * Summary:     Packet counters kept per face and per originating IXM
+ * Contains:    u32 counts of (r)esult packets received, forwarded, dropped as
+ *              duplicates, spam or stale, and packets that failed to parse
+ */
+struct COUNTERS
+{
+  u32 rx; // well-formed (r)esult packets received
+  u32 fwd; // packets passed on to the neighbors
+  u32 dup; // packets dropped for not being newer than the last one
+  u32 spam; // packets dropped for exceeding the origin's allowance
+  u32 stale; // packets dropped for belonging to a retired job
+  u32 bad; // packets that failed to parse (per face only)
+};
+
+/*
+ * Summary:     Fixed-bucket histogram of times in milliseconds
+ * Contains:    u32 count per bucket, u32 largest time seen
+ */
+struct HISTOGRAM
+{
+  u32 bucket[HIST_BUCKETS]; // times falling in each bucket
+  u32 max; // largest time seen
+};
+
+SYNERGY_STATE struct COUNTERS FACE_COUNT_ARR[4]; // packet counters per face
+SYNERGY_STATE struct HISTOGRAM ROUND_HIST; // time between the rounds of a job
+SYNERGY_STATE struct HISTOGRAM LATENCY_HIST; // time from the start of a round to each node's result
+
+#ifdef SYNERGY_PROFILE
+/*
+ * Summary:     Time spent in one instrumented piece of code
+ * Contains:    u32 calls, u32 min/max time, u64 total time, u32 count per
+ *              timing bucket (all times in microseconds)
+ */
+struct PROBE
+{
+  u32 count; // calls timed
+  u32 min; // shortest call
+  u32 max; // longest call
+  u64 total; // time across all calls
+  u32 bucket[PROBE_BUCKETS]; // calls falling in each bucket
+};
+
+SYNERGY_STATE struct PROBE PROBE_ARR[PROBE_COUNT]; // timings per probe
+const char *PROBE_NAME_ARR[PROBE_COUNT] =
+  { "calculate", "r_handler", "d_handler", "log", "compileResults",
+      "heartBeat", "printTable", "tableStep", "R_ZPrinter", "R_ZScanner",
+      "D_ZScanner", "FWD_R_PKT", "flushQueues", "b_handler" }; // probe names for the dump
+
+void
+probeAdd(u32 PROBE_ID, u32 TIME);
+
+/*
+ * Summary:     Times the rest of the block it is declared in
+ * Contains:    u32 probe, u32 start time in microseconds
+ */
+struct PROBE_SCOPE
+{
+  u32 probe; // probe the time is charged to
+  u32 start; // time the block was entered
+
+  PROBE_SCOPE(u32 PROBE_ID) :
+    probe(PROBE_ID), start(micros())
+  {
+  }
+
+  ~PROBE_SCOPE()
+  {
+    probeAdd(probe, micros() - start);
+  }
+};
+
+#define PROFILE(PROBE_ID) PROBE_SCOPE PROBE_HERE(PROBE_ID)
+#else
+#define PROFILE(PROBE_ID)
+#endif
+
+#ifdef SYNERGY_TRACE
+/*
+ * Summary:     One traced event: a packet received or sent, or a heartbeat
+ * Contains:    u32 time, u8 kind ('r', 'd' or 'p' received, 'o' sent, 'h'
+ *              heartbeat), u8 face, packet contents ((d)istribute requests use
+ *              doa1, doa2 and weight; (p)ings use key)
+ */
+struct TRACE
+{
+  u32 time; // millis() when the event happened
+  u8 kind; // what happened
+  u8 face; // face the packet came in or went out on
+  struct R_PKT pkt; // what the packet carried
+};
+
+SYNERGY_STATE struct TRACE TRACE_ARR[TRACE_LENGTH]; // ring of the newest events
+SYNERGY_STATE u32 TRACE_COUNT = 0; // events traced since the last dump, TRACE_LENGTH at most are kept
+
+#define TRACE_EVENT(KIND, FACE, PKT) traceEvent(KIND, FACE, PKT)
+#else
+#define TRACE_EVENT(KIND, FACE, PKT)
+#endif
+
+/*
+ * Summary:     Everything the host keeps on an IXM node besides its ID (in
+ *              ID_NODE_ARR at the same index).  Host times are kept as 16-bit
+ *              offsets from HEARD_BASE, packet spacings in 16 bits.
+ * Contains:    u32 newest packet key, host time last heard from, ping count,
+ *              smoothed packet spacing, face, packet allowance and counters
+ */
+struct NODE
+{
+  u32 stamp; // last-received time-stamp from the node's own packets
+  u16 heard; // host time the node was last heard from, less HEARD_BASE
+  u16 pings; // ping count
+  u16 gap; // smoothed time between packets (scaled by 8)
+  u16 gap_dev; // smoothed deviation of that time (scaled by 4)
+  u8 face :2; // face the node was last heard on
+  u8 gaps :4; // packet spacings measured, up to IDLE_WARMUP
+  u8 neighbor :1; // pings the host over a face, so it is heard from every pingFaces_PERIOD
+  struct TOKEN_BUCKET bucket; // packet allowance
+  struct COUNTERS count; // packet counters
+};
+
+SYNERGY_STATE struct NODE NODE_ARR[ARR_LENGTH]; // IXM nodes heard from, in the order of ID_NODE_ARR
+SYNERGY_STATE struct TOKEN_BUCKET FACE_BUCKET_ARR[4]; // packet allowance per face
+SYNERGY_STATE struct TOKEN_BUCKET SEND_BUCKET; // packets of its own the host may send, so the other boards relay all of them
+SYNERGY_STATE struct TX_QUEUE TX_QUEUE_ARR[4]; // outgoing packets per face
+
+/*
+ * Summary:     Sampling kernel: generates points on the lanes' random streams
+ *              and counts those inside the circle.  Point i is drawn from lane
+ *              i % SAMPLE_LANES, so any kernel given the same lanes and a count
+ *              that is a multiple of SAMPLE_LANES must count the same points.
+ */
+typedef u32
+(*SAMPLER)(u32 *LANE_ARR, u32 COUNT);
+
+u32
+samplePoints(u32 *LANE_ARR, u32 COUNT);
+
+SYNERGY_STATE u32 SAMPLE_LANE_ARR[SAMPLE_LANES]; // state of each lane's random stream
+SAMPLER SAMPLE_KERNEL = samplePoints; // kernel calculate() uses; host builds may swap in a vectorized one
+
 #endif